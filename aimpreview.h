@@ -0,0 +1,195 @@
+#pragma once
+//==============================================================================
+//                                Aim Preview
+//==============================================================================
+//
+// Predicted path of the cue ball, and of the first ball it hits, for the shot
+// the table is lined up for. The shot is played out on a scratch Simulation
+// as if the cue struck now, until AIM_PREVIEW_EVENTS collisions involving
+// either ball, the table comes to rest, or AIM_PREVIEW_SECONDS run out.
+//
+// Working the path out takes a few hundred steps, so it is cached: update()
+// only plays the shot again when something it depends on has changed, i.e.
+// the balls, the table config or the solver. Where the cue is doesn't change
+// the shot, only when it happens, so moving the cue costs a hash.
+//
+// Each path is a polyline of table (x, z) pairs, a point at every collision
+// and every AIM_PREVIEW_SAMPLE_STEPS steps in between so curves from cloth
+// friction show. AimPath is plain data and can be copied to the renderer.
+//
+//==============================================================================
+#include "simulation.h"
+
+// Collisions involving the cue ball or the ball it hits before the preview stops
+const int AIM_PREVIEW_EVENTS = 3;
+
+const double AIM_PREVIEW_SECONDS = 5.0;
+const int AIM_PREVIEW_SAMPLE_STEPS = 6;
+
+// Most points on one line
+const int AIM_PREVIEW_POINTS = 128;
+
+
+struct AimLine
+{
+    int ball;                                   // -1 if there's no line
+    int count;
+    float points[AIM_PREVIEW_POINTS][2];        // x, z
+
+    void clear(int ball)
+    {
+        this->ball = ball;
+        this->count = 0;
+    }
+
+    // The last point is overwritten once full, so the line always ends where the ball did
+    void add(float x, float z)
+    {
+        int i = this->count < AIM_PREVIEW_POINTS ? this->count++ : AIM_PREVIEW_POINTS - 1;
+        this->points[i][0] = x;
+        this->points[i][1] = z;
+    }
+};
+
+struct AimPath
+{
+    AimLine cue;
+    AimLine object;
+    unsigned version;           // Changes whenever the lines do
+};
+
+
+class AimPreview : private CollisionListener
+{
+public:
+    AimPreview()
+    {
+        this->path.cue.clear(-1);
+        this->path.object.clear(-1);
+        this->path.version = 0;
+    }
+
+    // Bring the preview up to date with the table. Returns true if the path
+    // changed. Once the cue has struck there is nothing to preview.
+    bool update(const Simulation& table)
+    {
+        if (table.cueHit)
+        {
+            if (!this->valid && this->path.cue.ball < 0)
+                return false;
+            this->valid = false;
+            this->path.cue.clear(-1);
+            this->path.object.clear(-1);
+            this->path.version++;
+            return true;
+        }
+
+        const unsigned hash = tableHash(table.balls, 0.0f, false);
+        if (this->valid && hash == this->hash && table.solver == this->solver
+            && table.config == this->config)
+            return false;
+
+        this->valid = true;
+        this->hash = hash;
+        this->solver = table.solver;
+        this->config = table.config;
+        this->trace(table);
+        this->path.version++;
+        return true;
+    }
+
+    const AimPath& current() const { return this->path; }
+
+private:
+    AimPath path;
+
+    // What the cached path was worked out from
+    bool valid = false;
+    unsigned hash = 0;
+    SimSolver solver = SIM_SOLVER_STEP;
+    SimConfig config;
+
+    Simulation scratch;
+    TableSnapshot start;
+    int events = 0;
+
+    void trace(const Simulation& table)
+    {
+        Simulation& sim = this->scratch;
+        table.save(this->start);
+        sim.restore(this->start);
+        sim.observer = nullptr;
+        sim.collisions.queue = nullptr;
+        sim.collisions.listener = this;
+
+        // Strike on the next step with the cue ball where it lies. In play it
+        // is pushed up to the cue tip, at most a cue move further back.
+        const BallTable& b = sim.balls;
+        sim.cueZ = b.z[CUE_BALL] + 0.01f;
+
+        this->events = 0;
+        this->path.cue.clear(CUE_BALL);
+        this->path.object.clear(-1);
+        this->path.cue.add(b.x[CUE_BALL], b.z[CUE_BALL]);
+
+        const int steps = (int)(AIM_PREVIEW_SECONDS / SIM_FIXED_DT);
+        for (int s = 1; s <= steps && this->events < AIM_PREVIEW_EVENTS; s++)
+        {
+            sim.step();
+            if (sim.idle())
+                break;
+            if (s % AIM_PREVIEW_SAMPLE_STEPS == 0)
+            {
+                this->sample(this->path.cue);
+                this->sample(this->path.object);
+            }
+        }
+
+        // Where each ball stopped, or was when the preview did
+        if (this->events < AIM_PREVIEW_EVENTS)
+        {
+            this->sample(this->path.cue);
+            this->sample(this->path.object);
+        }
+    }
+
+    // Adds the ball's position unless it is gone or its line hasn't started
+    void sample(AimLine& line)
+    {
+        const BallTable& b = this->scratch.balls;
+        if (line.ball >= 0 && line.count > 0 && !b.pocketed(line.ball))
+            line.add(b.x[line.ball], b.z[line.ball]);
+    }
+
+    // Called from inside scratch's step, with the balls where they are now
+    void collided(const CollisionEvent& e) override
+    {
+        if (this->events >= AIM_PREVIEW_EVENTS)
+            return;
+
+        AimLine& cue = this->path.cue;
+        AimLine& object = this->path.object;
+        const BallTable& b = this->scratch.balls;
+
+        // The object ball's line starts where it is hit
+        if (e.type == SIM_EVENT_BALL_HIT && object.ball < 0 && (e.a == cue.ball || e.b == cue.ball))
+            object.clear(e.a == cue.ball ? e.b : e.a);
+
+        bool tracked = false;
+        AimLine* lines[2] = { &cue, &object };
+        for (AimLine* line : lines)
+        {
+            if (line->ball < 0 || (line->ball != e.a && line->ball != e.b))
+                continue;
+            tracked = true;
+
+            // A pocket ends the line where the ball dropped
+            if (e.type == SIM_EVENT_POCKET)
+                line->add(e.x, e.z);
+            else
+                line->add(b.x[line->ball], b.z[line->ball]);
+        }
+        if (tracked)
+            this->events++;
+    }
+};
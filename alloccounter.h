@@ -0,0 +1,56 @@
+#pragma once
+//==============================================================================
+//                              Allocation Counter
+//==============================================================================
+//
+// Counts heap allocations made through operator new, per thread, so a
+// stretch of code can be shown not to allocate: read allocationCount()
+// before and after it. This is how the render loop checks its draw path.
+//
+// It works by replacing the global operator new and delete, which may only
+// be done once in a program, so include it from main.cpp alone. Memory a
+// library takes with malloc, or through the operator new of its own DLL,
+// isn't counted.
+//
+//==============================================================================
+#include <cstdlib>
+#include <new>
+
+static thread_local unsigned long long threadAllocations = 0;
+
+// Allocations made on the calling thread so far
+inline unsigned long long allocationCount() { return threadAllocations; }
+
+
+void* operator new(std::size_t size)
+{
+    threadAllocations++;
+    void* p = std::malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    threadAllocations++;
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    threadAllocations++;
+    return std::malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
@@ -0,0 +1,190 @@
+#pragma once
+//==============================================================================
+//                                Ball Renderer
+//==============================================================================
+//
+// Draws every ball on the table with a single glDrawElementsInstanced,
+// however many there are. All balls share the geometry of one model; what
+// differs per ball is its model matrix and which face image it wears.
+//
+// Each frame begin() empties the instance list, add() appends a ball still
+// on the table (pocketed balls are simply not added) and submit() uploads
+// the list to an instance buffer and queues the draw (see renderqueue.h).
+// The face images are layers of one GL_TEXTURE_2D_ARRAY, picked per
+// instance, so nothing is rebound between balls. Nothing is allocated after
+// init().
+//
+// Only the model's textured meshes are drawn: ball.obj also holds an
+// untextured cube hidden inside the sphere. The instance attributes are
+// added to those meshes' vertex arrays, so the model shouldn't be drawn
+// through Model::Draw as well. Shaders are objects/ballVertex.glsl and
+// objects/ballFragment.glsl.
+//
+//==============================================================================
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <SOIL.h>
+
+#include "balltable.h"
+#include "shader.h"
+#include "model.h"
+#include "renderqueue.h"
+
+// Attribute locations the per-ball data starts at, after the mesh's 0 to 2
+const GLuint BALL_INSTANCE_MODEL = 3;       // mat4, takes 3 to 6
+const GLuint BALL_INSTANCE_LAYER = 7;
+
+
+struct BallInstance
+{
+    glm::mat4 model;
+    GLfloat layer;          // Texture array layer of the ball's face
+};
+
+
+class BallRenderer
+{
+public:
+    // `images` are the face images, ball id i wearing images[i % imageCount].
+    // The renderer's sampler is set on `shader` here, on texture unit 0.
+    void init(const Model& model, const Shader& shader, const char* const* images, int imageCount)
+    {
+        for (const Mesh& mesh : model.meshes)
+        {
+            if (!mesh.textures.empty())
+                this->meshes.push_back(&mesh);
+        }
+
+        glGenBuffers(1, &this->instanceVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(this->instances), NULL, GL_STREAM_DRAW);
+        for (const Mesh* mesh : this->meshes)
+        {
+            glBindVertexArray(mesh->VAO);
+            for (GLuint c = 0; c < 4; c++)
+            {
+                glEnableVertexAttribArray(BALL_INSTANCE_MODEL + c);
+                glVertexAttribPointer(BALL_INSTANCE_MODEL + c, 4, GL_FLOAT, GL_FALSE, sizeof(BallInstance),
+                    (GLvoid*)(offsetof(BallInstance, model) + c * sizeof(glm::vec4)));
+                glVertexAttribDivisor(BALL_INSTANCE_MODEL + c, 1);
+            }
+            glEnableVertexAttribArray(BALL_INSTANCE_LAYER);
+            glVertexAttribPointer(BALL_INSTANCE_LAYER, 1, GL_FLOAT, GL_FALSE, sizeof(BallInstance),
+                (GLvoid*)offsetof(BallInstance, layer));
+            glVertexAttribDivisor(BALL_INSTANCE_LAYER, 1);
+        }
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        this->loadFaces(images, imageCount);
+        shader.Use();
+        glUniform1i(shader.Uniform("faces"), 0);
+    }
+
+    void destroy()
+    {
+        glDeleteBuffers(1, &this->instanceVBO);
+        glDeleteTextures(1, &this->faces);
+        this->instanceVBO = this->faces = 0;
+    }
+
+    void begin() { this->count = 0; }
+
+    void add(int id, const glm::mat4& model)
+    {
+        if (this->count >= POOL_MAX_BALLS)
+            return;
+        BallInstance& b = this->instances[this->count++];
+        b.model = model;
+        b.layer = (GLfloat)(id % this->layers);
+    }
+
+    // Upload this frame's instances and queue the draw, with `shader` the
+    // slot ballShader was added to the queue under
+    void submit(RenderQueue& queue, int shader)
+    {
+        if (!this->count)
+            return;
+
+        // Orphan last frame's buffer rather than wait for the GPU to finish with it
+        glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(this->instances), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, this->count * sizeof(BallInstance), this->instances);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        for (const Mesh* mesh : this->meshes)
+        {
+            queue.submit(shader, mesh->VAO, (GLsizei)mesh->indices.size(), GL_TEXTURE_2D_ARRAY, this->faces,
+                glm::mat4(1), 0.0f, this->count);
+        }
+    }
+
+private:
+    std::vector<const Mesh*> meshes;
+    GLuint instanceVBO = 0;
+    GLuint faces = 0;
+    int layers = 1;
+
+    BallInstance instances[POOL_MAX_BALLS];
+    int count = 0;
+
+    // Layers must all be one size, so images that differ from the first are
+    // resampled (nearest) to it
+    void loadFaces(const char* const* images, int imageCount)
+    {
+        this->layers = imageCount > 0 ? imageCount : 1;
+        glGenTextures(1, &this->faces);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, this->faces);
+
+        int width = 0, height = 0;
+        std::vector<unsigned char> scaled;
+        for (int layer = 0; layer < imageCount; layer++)
+        {
+            int w, h;
+            unsigned char* image = SOIL_load_image(images[layer], &w, &h, 0, SOIL_LOAD_RGB);
+            if (!image)
+            {
+                std::cout << "ERROR::BALLS::TEXTURE_NOT_LOADED " << images[layer] << std::endl;
+                continue;
+            }
+            if (!width)
+            {
+                width = w;
+                height = h;
+                glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB, width, height, this->layers, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+            }
+
+            const unsigned char* pixels = image;
+            if (w != width || h != height)
+            {
+                scaled.resize((size_t)width * height * 3);
+                for (int y = 0; y < height; y++)
+                {
+                    const unsigned char* row = image + (size_t)(y * h / height) * w * 3;
+                    for (int x = 0; x < width; x++)
+                    {
+                        const unsigned char* p = row + (size_t)(x * w / width) * 3;
+                        unsigned char* q = &scaled[((size_t)y * width + x) * 3];
+                        q[0] = p[0];
+                        q[1] = p[1];
+                        q[2] = p[2];
+                    }
+                }
+                pixels = scaled.data();
+            }
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+            SOIL_free_image_data(image);
+        }
+
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+};
@@ -0,0 +1,116 @@
+#pragma once
+//==============================================================================
+//                                Ball Table
+//==============================================================================
+//
+// Every ball on the table stored as a structure of arrays. A ball is just an
+// integer id indexing the arrays, so passes over positions or velocities walk
+// straight through memory and the compiler is free to vectorize them.
+//
+//==============================================================================
+
+// Room for a snooker set (22) with some spare. Override before including this
+// header for bigger tables. Kept a multiple of 8 so SIMD passes can always
+// read whole lanes.
+#ifndef POOL_MAX_BALLS
+#define POOL_MAX_BALLS 32
+#endif
+
+static_assert(POOL_MAX_BALLS % 8 == 0, "POOL_MAX_BALLS must be a multiple of 8");
+
+const int CUE_BALL = 0;     // The cue always strikes ball 0
+
+// Per ball state bits
+enum BallFlag
+{
+    BALL_MOVING = 1 << 0,       // Being integrated this step, clear while at rest
+    BALL_POCKETED = 1 << 1      // Off the table
+};
+
+
+struct BallTable
+{
+    int count;
+
+    // Position on the cloth and velocity in table units per second
+    float x[POOL_MAX_BALLS];
+    float z[POOL_MAX_BALLS];
+    float vx[POOL_MAX_BALLS];
+    float vz[POOL_MAX_BALLS];
+
+    // Spin as the velocity it alone would roll the ball at (see motion.h)
+    float rx[POOL_MAX_BALLS];
+    float rz[POOL_MAX_BALLS];
+
+    unsigned char flags[POOL_MAX_BALLS];
+
+    BallTable() { this->clear(); }
+
+    // Remove every ball and zero the unused slots
+    void clear()
+    {
+        this->count = 0;
+        for (int i = 0; i < POOL_MAX_BALLS; i++)
+        {
+            this->x[i] = this->z[i] = 0.0f;
+            this->vx[i] = this->vz[i] = 0.0f;
+            this->rx[i] = this->rz[i] = 0.0f;
+            this->flags[i] = 0;
+        }
+    }
+
+    // Place a ball and return its id, or -1 if the table is full
+    int add(float x, float z, float vx = 0.0f, float vz = 0.0f, unsigned char flags = 0)
+    {
+        if (this->count >= POOL_MAX_BALLS)
+            return -1;
+
+        int id = this->count++;
+        this->x[id] = x;
+        this->z[id] = z;
+        this->vx[id] = vx;
+        this->vz[id] = vz;
+        this->rx[id] = this->rz[id] = 0.0f;
+        this->flags[id] = flags;
+        return id;
+    }
+
+    bool moving(int id) const { return (this->flags[id] & BALL_MOVING) != 0; }
+    bool pocketed(int id) const { return (this->flags[id] & BALL_POCKETED) != 0; }
+
+    bool anyMoving() const
+    {
+        unsigned char all = 0;
+        for (int i = 0; i < this->count; i++)
+            all |= this->flags[i];
+        return (all & BALL_MOVING) != 0;
+    }
+
+    // Bring every ball slower than minSpeed to rest. The velocity is kept, as
+    // the collision response works from the struck ball's stored velocity.
+    void settle(float minSpeed)
+    {
+        const float min2 = minSpeed * minSpeed;
+        for (int i = 0; i < this->count; i++)
+        {
+            bool slow = this->vx[i] * this->vx[i] + this->vz[i] * this->vz[i] < min2;
+            this->flags[i] &= slow ? (unsigned char)~BALL_MOVING : (unsigned char)0xFF;
+        }
+    }
+
+    // Move every moving ball in a straight line along its velocity. Resting and pocketed balls are
+    // multiplied by zero rather than branched around so the loop vectorizes.
+    void integrate(float dt) { this->integrate(dt, this->count); }
+
+    // Same over the first n slots, n >= count. A constant n (see
+    // tableprofiles.h) gives the compiler a fixed trip count.
+    void integrate(float dt, int n)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            float step = (this->flags[i] & BALL_MOVING) ? dt : 0.0f;
+            this->x[i] += this->vx[i] * step;
+            this->z[i] += this->vz[i] * step;
+        }
+    }
+};
@@ -0,0 +1,126 @@
+#pragma once
+//==============================================================================
+//                                Broadphase
+//==============================================================================
+//
+// Uniform grid over the cloth with cells one ball diameter wide. Two balls can
+// only be touching if they sit in the same or neighbouring cells, so only
+// those pairs are handed to the narrowphase.
+//
+// Rather than clearing a cell array every step, balls are sorted by cell key
+// and each ball looks up the three key ranges (rows above, level, below) that
+// cover its 3x3 neighbourhood. No allocation, and cost scales with the number
+// of balls rather than the size of the table.
+//
+//==============================================================================
+#include <cmath>
+
+#include "balltable.h"
+
+class BallGrid
+{
+public:
+    // Bucket every ball still on the table. minX/minZ is the table corner and
+    // width its size along x; balls outside the table are clamped to the edge.
+    void build(const BallTable& balls, float minX, float minZ, float width, float cellSize)
+    {
+        this->originX = minX;
+        this->originZ = minZ;
+        this->invCell = 1.0f / cellSize;
+        this->cols = (int)std::ceil(width * this->invCell) + 1;
+        this->count = 0;
+
+        for (int i = 0; i < balls.count; i++)
+        {
+            if (balls.flags[i] & BALL_POCKETED)
+                continue;
+
+            int key = this->cellKey(balls.x[i], balls.z[i]);
+            this->cellOf[i] = key;
+
+            // Insertion sort; a rack is small and mostly sorted from last step
+            int k = this->count++;
+            while (k > 0 && this->keys[k - 1] > key)
+            {
+                this->keys[k] = this->keys[k - 1];
+                this->ids[k] = this->ids[k - 1];
+                k--;
+            }
+            this->keys[k] = key;
+            this->ids[k] = i;
+        }
+    }
+
+    // Balls a moving ball i has to be tested against: every resting ball in
+    // the same or bordering cells, plus moving ones above i (the pair is
+    // handled from the lower id). Lets the caller skip resting balls entirely.
+    // i must be on the table. flags is a copy of the ball flags taken before
+    // any contact is handled. Returns how many written.
+    int wakeNeighbours(const unsigned char* flags, int i, int* out) const
+    {
+        return this->gather(i, out, [&](int j)
+        {
+            return j != i && (j > i || !(flags[j] & BALL_MOVING));
+        });
+    }
+
+private:
+    float originX = 0.0f;
+    float originZ = 0.0f;
+    float invCell = 1.0f;
+    int cols = 1;
+
+    int count = 0;                      // Balls in the grid
+    int keys[POOL_MAX_BALLS];           // Cell keys, ascending
+    int ids[POOL_MAX_BALLS];            // Ball id for each entry of keys
+    int cellOf[POOL_MAX_BALLS];         // Cell key by ball id
+
+    // Row-major cell index, with one spare column either side so neighbours
+    // of an edge cell never wrap onto the next row
+    int cellKey(float x, float z) const
+    {
+        int col = (int)((x - this->originX) * this->invCell);
+        int row = (int)((z - this->originZ) * this->invCell);
+        if (col < 0) col = 0;
+        if (col > this->cols - 1) col = this->cols - 1;
+        if (row < 0) row = 0;
+        return (row + 1) * (this->cols + 2) + col + 1;
+    }
+
+    // Ids in the 3x3 cells around ball i that pass keep(j)
+    template <typename Keep>
+    int gather(int i, int* out, const Keep& keep) const
+    {
+        int key = this->cellOf[i];
+        int n = 0;
+
+        for (int row = -1; row <= 1; row++)
+        {
+            int lo = key + row * (this->cols + 2) - 1;
+            int hi = key + row * (this->cols + 2) + 1;
+
+            for (int t = this->lowerBound(lo); t < this->count && this->keys[t] <= hi; t++)
+            {
+                int j = this->ids[t];
+                if (keep(j))
+                    out[n++] = j;
+            }
+        }
+        return n;
+    }
+
+    // First entry whose key is >= key
+    int lowerBound(int key) const
+    {
+        int lo = 0, hi = this->count;
+        while (lo < hi)
+        {
+            int mid = (lo + hi) / 2;
+            if (this->keys[mid] < key)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+};
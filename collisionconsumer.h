@@ -0,0 +1,79 @@
+#pragma once
+//==============================================================================
+//                                Collision Consumer
+//==============================================================================
+//
+// Drains a CollisionQueue on its own thread and hands each record to a
+// callback, e.g. to play a sound or log telemetry. Whatever the callback
+// does, and however long it takes, the physics thread pushing the records
+// never waits for it.
+//
+// The queue has no wake up signal, so the thread checks it every
+// COLLISION_POLL_MS while idle. That is well under a frame and far below
+// what anyone can hear.
+//
+//==============================================================================
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+#include "collisionevents.h"
+
+const int COLLISION_POLL_MS = 2;
+
+
+class CollisionConsumer
+{
+public:
+    typedef std::function<void(const CollisionEvent&)> Handler;
+
+    CollisionConsumer(CollisionQueue& queue, Handler handler) : queue(queue), handler(handler) {}
+
+    ~CollisionConsumer() { this->stop(); }
+
+    void start()
+    {
+        if (this->thread.joinable())
+            return;
+        this->running.store(true);
+        this->thread = std::thread(&CollisionConsumer::run, this);
+    }
+
+    // Handles whatever is still queued, then returns
+    void stop()
+    {
+        if (!this->thread.joinable())
+            return;
+        this->running.store(false);
+        this->thread.join();
+    }
+
+    unsigned long long handled() const { return this->count.load(); }
+
+private:
+    CollisionQueue& queue;
+    Handler handler;
+    std::thread thread;
+    std::atomic<bool> running{ false };
+    std::atomic<unsigned long long> count{ 0 };
+
+    void run()
+    {
+        for (;;)
+        {
+            const bool last = !this->running.load();
+
+            CollisionEvent e;
+            while (this->queue.pop(e))
+            {
+                this->handler(e);
+                this->count.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            if (last)
+                return;
+            std::this_thread::sleep_for(std::chrono::milliseconds(COLLISION_POLL_MS));
+        }
+    }
+};
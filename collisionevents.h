@@ -0,0 +1,66 @@
+#pragma once
+//==============================================================================
+//                                Collision Events
+//==============================================================================
+//
+// Typed record of everything that happens on the table: two balls meeting, a
+// ball off a cushion, a ball dropping. The stepping loop and the event solver
+// hand one record per collision to their CollisionSink, which passes it on
+// two ways:
+//   - into a CollisionQueue, a lock-free single producer ring, so sound or
+//     telemetry can drain it on another thread without the physics waiting.
+//     If the consumer falls behind the queue fills and new records are
+//     dropped.
+//   - to a CollisionListener called right there on the stepping thread,
+//     e.g. an EventLogWriter in batch runs (see eventlog.h).
+// Nobody listening costs a null check. The SimEvent flags returned by
+// Simulation::step() are the same either way.
+//
+//==============================================================================
+#include "simconfig.h"
+#include "spscring.h"
+
+// Records the queue holds before dropping. A rack break raises a few dozen.
+const size_t COLLISION_QUEUE_SIZE = 256;
+
+
+struct CollisionEvent
+{
+    unsigned type;                  // SIM_EVENT_BALL_HIT, SIM_EVENT_CUSHION or SIM_EVENT_POCKET
+    int a, b;                       // Balls involved, b is -1 unless two balls met
+    float x, z;                     // Where on the table
+    float speed;                    // Closing speed along the contact normal, or the ball's speed into a pocket
+    unsigned long long step;        // Simulation step it happened in
+};
+
+typedef SpscRing<CollisionEvent, COLLISION_QUEUE_SIZE> CollisionQueue;
+
+// Told about every collision on the thread that steps the table
+class CollisionListener
+{
+public:
+    virtual ~CollisionListener() {}
+    virtual void collided(const CollisionEvent& e) = 0;
+};
+
+
+// Where the physics sends its records, and the step they belong to
+struct CollisionSink
+{
+    CollisionQueue* queue = nullptr;
+    CollisionListener* listener = nullptr;
+    unsigned long long step = 0;
+
+    bool listening() const { return this->queue || this->listener; }
+
+    void report(unsigned type, int a, int b, float x, float z, float speed) const
+    {
+        if (!this->listening())
+            return;
+        CollisionEvent e = { type, a, b, x, z, speed, this->step };
+        if (this->queue)
+            this->queue->push(e);
+        if (this->listener)
+            this->listener->collided(e);
+    }
+};
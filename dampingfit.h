@@ -0,0 +1,488 @@
+#pragma once
+//==============================================================================
+//                                Damping Fit
+//==============================================================================
+//
+// Fits the cushion and ball damping constants to measured trajectories. The
+// reference is a CSV of ball positions over time, one row per ball per
+// sample, grouped into shots:
+//
+//     shot,time,ball,x,z
+//     0,0.0000,0,0.00,43.00
+//     0,0.0000,1,-35.00,-30.00
+//     0,0.0333,0,-0.83,41.34
+//
+// Each ball starts exactly where it was first seen, moving along a line
+// from there through its next few sightings (up to FIT_START_SAMPLES in
+// all), with no spin, as just after a cue strike. The shot is replayed
+// through Simulation and compared with every later sample at the fixed step
+// nearest its time.
+//
+// A collision or pocket one step early or late sends a replay somewhere
+// else entirely, and squared distances from those few shots would swamp
+// the rest. So a shot is only compared up to its first sample more than a
+// ball radius from the replay; that sample and every one after it count as
+// a radius off. The cost is the RMS of these distances over all samples.
+//
+// The search is Nelder-Mead. Every iteration tries the reflected, expanded
+// and both contracted points at once, and every shot of every point is a
+// separate job on the ThreadPool, so an iteration costs about one shot
+// replay per core however many points it needs. Each worker keeps one
+// Simulation and reuses it for every job.
+//
+// The keep factors only matter when ballRestitution is 0; otherwise
+// ballRestitution is fitted in their place. Constants are clamped to 0..1.
+// A compiled table profile would ignore fitted cushion values, so the fit
+// runs on the configured kernel.
+//
+//==============================================================================
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "simulation.h"
+#include "threadpool.h"
+
+enum DampingParam
+{
+    DAMP_CUSHION_X,
+    DAMP_CUSHION_Z,
+    DAMP_STRIKER_X,
+    DAMP_STRIKER_Z,
+    DAMP_STRUCK_X,
+    DAMP_STRUCK_Z,
+    DAMP_RESTITUTION,
+    DAMP_PARAM_COUNT
+};
+
+const char* const DAMPING_PARAM_NAMES[DAMP_PARAM_COUNT] =
+{
+    "cushionDecayX", "cushionDecayZ", "strikerKeepX", "strikerKeepZ", "struckKeepX", "struckKeepZ", "ballRestitution"
+};
+
+inline float* dampingParam(SimConfig& c, int param)
+{
+    switch (param)
+    {
+    case DAMP_CUSHION_X: return &c.cushionDecayX;
+    case DAMP_CUSHION_Z: return &c.cushionDecayZ;
+    case DAMP_STRIKER_X: return &c.strikerKeepX;
+    case DAMP_STRIKER_Z: return &c.strikerKeepZ;
+    case DAMP_STRUCK_X: return &c.struckKeepX;
+    case DAMP_STRUCK_Z: return &c.struckKeepZ;
+    default: return &c.ballRestitution;
+    }
+}
+
+
+// Sightings of each ball used for its start rather than the cost. They
+// should all come before the ball's first collision.
+const int FIT_START_SAMPLES = 4;
+
+
+struct TrackSample
+{
+    unsigned step;          // Fixed step nearest the sample time, from the shot's start
+    int ball;
+    float x, z;
+};
+
+struct ReferenceShot
+{
+    int id;
+    BallTable start;
+    std::vector<TrackSample> samples;   // In step order, first FIT_START_SAMPLES per ball left out
+    unsigned steps;                     // Step of the last sample
+};
+
+// Read a reference CSV. Rows may come in any order. Returns false with a
+// message on a bad row or a shot with a ball seen only once.
+inline bool loadReferenceShots(const char* path, std::vector<ReferenceShot>& shots)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::FIT::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+        return false;
+    }
+
+    struct Row { int shot; double time; int ball; float x, z; };
+    std::vector<Row> rows;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        if (line.empty() || line[0] == '#' || line.compare(0, 4, "shot") == 0)
+            continue;
+
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream in(line);
+        Row r;
+        if (!(in >> r.shot >> r.time >> r.ball >> r.x >> r.z) || r.ball < 0 || r.ball >= POOL_MAX_BALLS)
+        {
+            std::cout << "ERROR::FIT::BAD_LINE " << path << ":" << lineNumber << " " << line << std::endl;
+            return false;
+        }
+        rows.push_back(r);
+    }
+
+    std::stable_sort(rows.begin(), rows.end(), [](const Row& a, const Row& b)
+    {
+        return a.shot != b.shot ? a.shot < b.shot : a.time < b.time;
+    });
+
+    shots.clear();
+    for (size_t begin = 0; begin < rows.size();)
+    {
+        size_t end = begin;
+        while (end < rows.size() && rows[end].shot == rows[begin].shot)
+            end++;
+
+        ReferenceShot shot;
+        shot.id = rows[begin].shot;
+        shot.steps = 0;
+        const double t0 = rows[begin].time;
+
+        // Each ball starts at its first sighting; the velocity is the
+        // least-squares slope of a line from there through the next few,
+        // which evens out measurement noise
+        int seen[POOL_MAX_BALLS] = {};
+        double t1[POOL_MAX_BALLS] = {}, x1[POOL_MAX_BALLS] = {}, z1[POOL_MAX_BALLS] = {};
+        double stt[POOL_MAX_BALLS] = {}, stx[POOL_MAX_BALLS] = {}, stz[POOL_MAX_BALLS] = {};
+        int balls = 0;
+        for (size_t i = begin; i < end; i++)
+        {
+            const Row& r = rows[i];
+            int k = r.ball;
+            if (seen[k] == 0)
+            {
+                t1[k] = r.time;
+                x1[k] = r.x;
+                z1[k] = r.z;
+                balls = k + 1 > balls ? k + 1 : balls;
+            }
+            else if (seen[k] < FIT_START_SAMPLES)
+            {
+                double t = r.time - t1[k];
+                stt[k] += t * t;
+                stx[k] += t * (r.x - x1[k]);
+                stz[k] += t * (r.z - z1[k]);
+            }
+            else
+            {
+                TrackSample s;
+                s.step = (unsigned)std::floor((r.time - t0) / SIM_FIXED_DT + 0.5);
+                s.ball = k;
+                s.x = r.x;
+                s.z = r.z;
+                shot.samples.push_back(s);
+                shot.steps = s.step > shot.steps ? s.step : shot.steps;
+            }
+            seen[k]++;
+        }
+
+        shot.start.clear();
+        for (int k = 0; k < balls; k++)
+        {
+            if (seen[k] < 2 || stt[k] <= 0.0)
+            {
+                std::cout << "ERROR::FIT::BALL_SEEN_ONCE " << path << " shot " << shot.id << " ball " << k << std::endl;
+                return false;
+            }
+            // A ball first seen after the shot's start is moved back along
+            // its line to where it was then
+            float vx = (float)(stx[k] / stt[k]);
+            float vz = (float)(stz[k] / stt[k]);
+            float x = (float)(x1[k] - vx * (t1[k] - t0));
+            float z = (float)(z1[k] - vz * (t1[k] - t0));
+            bool moving = vx != 0.0f || vz != 0.0f;
+            shot.start.add(x, z, vx, vz, moving ? BALL_MOVING : 0);
+        }
+        shots.push_back(shot);
+        begin = end;
+    }
+    return !shots.empty();
+}
+
+
+struct FitSettings
+{
+    int iterations = 200;       // Nelder-Mead iterations per restart
+    int restarts = 2;           // Fresh simplexes around the best point so far
+    float step = 0.1f;          // Initial simplex size
+    double tolerance = 1e-4;    // Stop a restart once the simplex costs agree this closely (units)
+};
+
+struct FitResult
+{
+    SimConfig config;               // Base config with the fitted constants
+    double startCost = 0.0;         // RMS error in table units, each sample capped at a ball radius
+    double cost = 0.0;
+    unsigned long long evaluations = 0;
+    unsigned long long shotRuns = 0;
+    unsigned long long steps = 0;
+    double seconds = 0.0;
+};
+
+
+class DampingFit
+{
+public:
+    DampingFit(ThreadPool& pool, const std::vector<ReferenceShot>& shots) : pool(pool), shots(shots)
+    {
+        for (const ReferenceShot& s : shots)
+            this->samples += s.samples.size();
+    }
+
+    // Which constants are fitted for this table
+    static bool fitted(const SimConfig& base, int param)
+    {
+        if (param == DAMP_RESTITUTION)
+            return base.ballRestitution > 0.0f;
+        if (param >= DAMP_STRIKER_X)
+            return base.ballRestitution == 0.0f;
+        return true;
+    }
+
+    FitResult fit(const Simulation& table, const FitSettings& settings)
+    {
+        auto started = std::chrono::steady_clock::now();
+        this->base = table.config;
+        this->base.profile = -1;
+        this->solver = table.solver;
+        this->params.clear();
+        for (int p = 0; p < DAMP_PARAM_COUNT; p++)
+        {
+            if (fitted(this->base, p))
+                this->params.push_back(p);
+        }
+        this->evaluations = this->shotRuns = this->steps = 0;
+        std::fill(this->workerSteps.begin(), this->workerSteps.end(), 0ULL);
+
+        const size_t d = this->params.size();
+        Point best(d);
+        for (size_t i = 0; i < d; i++)
+            best[i] = *dampingParam(this->base, this->params[i]);
+
+        std::vector<Point> batch(1, best);
+        std::vector<double> costs;
+        this->evaluate(batch, costs);
+        double bestCost = costs[0];
+
+        FitResult result;
+        result.startCost = bestCost;
+        for (int r = 0; r <= settings.restarts; r++)
+            bestCost = this->nelderMead(best, bestCost, settings);
+
+        result.config = this->configFor(best);
+        result.cost = bestCost;
+        result.evaluations = this->evaluations;
+        result.shotRuns = this->shotRuns;
+        result.steps = this->steps;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return result;
+    }
+
+private:
+    typedef std::vector<float> Point;
+
+    ThreadPool& pool;
+    const std::vector<ReferenceShot>& shots;
+    size_t samples = 0;
+
+    SimConfig base;
+    SimSolver solver = SIM_SOLVER_STEP;
+    std::vector<int> params;
+    std::vector<Simulation> sims;       // One per worker
+    std::vector<double> errors;         // [point][shot]
+    std::vector<SimConfig> configs;     // One per point in the batch
+    std::vector<unsigned long long> workerSteps;
+
+    unsigned long long evaluations = 0;
+    unsigned long long shotRuns = 0;
+    unsigned long long steps = 0;
+
+    SimConfig configFor(const Point& p) const
+    {
+        SimConfig c = this->base;
+        for (size_t i = 0; i < p.size(); i++)
+        {
+            float v = p[i] < 0.0f ? 0.0f : (p[i] > 1.0f ? 1.0f : p[i]);
+            *dampingParam(c, this->params[i]) = v;
+        }
+        return c;
+    }
+
+    // RMS error of each point, every shot of every point run in parallel
+    void evaluate(const std::vector<Point>& points, std::vector<double>& costs)
+    {
+        const unsigned workers = this->pool.size();
+        const size_t n = this->shots.size();
+        if (this->sims.size() != workers)
+        {
+            this->sims.assign(workers, Simulation());
+            this->workerSteps.assign(workers, 0);
+        }
+
+        this->configs.resize(points.size());
+        for (size_t p = 0; p < points.size(); p++)
+            this->configs[p] = this->configFor(points[p]);
+        this->errors.assign(points.size() * n, 0.0);
+
+        this->pool.parallelFor(points.size() * n, 1,
+            [&](size_t begin, size_t end, unsigned worker)
+            {
+                unsigned long long ran = 0;
+                for (size_t k = begin; k < end; k++)
+                    this->errors[k] = this->replay(this->sims[worker], this->configs[k / n], this->shots[k % n], ran);
+                this->workerSteps[worker] += ran;
+            });
+
+        costs.assign(points.size(), 0.0);
+        for (size_t p = 0; p < points.size(); p++)
+        {
+            double sum = 0.0;
+            for (size_t s = 0; s < n; s++)
+                sum += this->errors[p * n + s];
+            costs[p] = this->samples ? std::sqrt(sum / this->samples) : 0.0;
+        }
+
+        this->evaluations += points.size();
+        this->shotRuns += points.size() * n;
+        this->steps = 0;
+        for (unsigned long long s : this->workerSteps)
+            this->steps += s;
+    }
+
+    // Sum of squared distances from the measured samples, up to the first
+    // that is more than a ball radius out; from there on each counts as one
+    // radius. Stops replaying at that point, since nothing after it counts.
+    double replay(Simulation& sim, const SimConfig& config, const ReferenceShot& shot, unsigned long long& ran) const
+    {
+        sim.config = config;
+        sim.solver = this->solver;
+        sim.balls = shot.start;
+        sim.cueHit = true;
+        sim.stepCount = 0;
+        sim.observer = nullptr;
+        sim.collisions.queue = nullptr;
+        sim.collisions.listener = nullptr;
+        sim.eventSolver.invalidate();
+
+        const double radius = 0.5 * config.ballDiameter;
+        const double mismatch = radius * radius;
+        const size_t n = shot.samples.size();
+        double error = 0.0;
+        unsigned step = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            const TrackSample& s = shot.samples[i];
+            for (; step < s.step; step++)
+                sim.step();
+            double dx = sim.balls.x[s.ball] - s.x;
+            double dz = sim.balls.z[s.ball] - s.z;
+            double d2 = dx * dx + dz * dz;
+            if (d2 > mismatch)
+            {
+                error += mismatch * (n - i);
+                break;
+            }
+            error += d2;
+        }
+        ran += step;
+        return error;
+    }
+
+    // One run from a fresh simplex around `best`. Returns the best cost and
+    // leaves the best point in `best`.
+    double nelderMead(Point& best, double bestCost, const FitSettings& settings)
+    {
+        const size_t d = best.size();
+        std::vector<Point> simplex(d + 1, best);
+        std::vector<double> cost(d + 1, bestCost);
+        std::vector<Point> batch;
+        std::vector<double> costs;
+
+        for (size_t i = 0; i < d; i++)
+            simplex[i + 1][i] += best[i] + settings.step > 1.0f ? -settings.step : settings.step;
+        batch.assign(simplex.begin() + 1, simplex.end());
+        this->evaluate(batch, costs);
+        std::copy(costs.begin(), costs.end(), cost.begin() + 1);
+
+        std::vector<size_t> order(d + 1);
+        for (int it = 0; it < settings.iterations; it++)
+        {
+            for (size_t i = 0; i <= d; i++)
+                order[i] = i;
+            std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return cost[a] < cost[b]; });
+            const size_t lo = order[0], hi = order[d], next = order[d - 1];
+            if (cost[hi] - cost[lo] < settings.tolerance)
+                break;
+
+            Point centre(d, 0.0f);
+            for (size_t i = 0; i < d; i++)
+            {
+                for (size_t k = 0; k < d; k++)
+                    centre[k] += simplex[order[i]][k] / d;
+            }
+
+            // Reflection, expansion, outside and inside contraction together
+            batch.assign(4, Point(d));
+            for (size_t k = 0; k < d; k++)
+            {
+                float toward = centre[k] - simplex[hi][k];
+                batch[0][k] = centre[k] + toward;
+                batch[1][k] = centre[k] + 2.0f * toward;
+                batch[2][k] = centre[k] + 0.5f * toward;
+                batch[3][k] = centre[k] - 0.5f * toward;
+            }
+            this->evaluate(batch, costs);
+
+            int take = -1;
+            if (costs[0] < cost[lo])
+                take = costs[1] < costs[0] ? 1 : 0;
+            else if (costs[0] < cost[next])
+                take = 0;
+            else if (costs[0] < cost[hi])
+                take = costs[2] <= costs[0] ? 2 : -1;
+            else
+                take = costs[3] < cost[hi] ? 3 : -1;
+
+            if (take >= 0)
+            {
+                simplex[hi] = batch[take];
+                cost[hi] = costs[take];
+                continue;
+            }
+
+            // Shrink towards the best point
+            batch.clear();
+            for (size_t i = 1; i <= d; i++)
+            {
+                Point& p = simplex[order[i]];
+                for (size_t k = 0; k < d; k++)
+                    p[k] = simplex[lo][k] + 0.5f * (p[k] - simplex[lo][k]);
+                batch.push_back(p);
+            }
+            this->evaluate(batch, costs);
+            for (size_t i = 1; i <= d; i++)
+                cost[order[i]] = costs[i - 1];
+        }
+
+        size_t lo = 0;
+        for (size_t i = 1; i <= d; i++)
+            lo = cost[i] < cost[lo] ? i : lo;
+        if (cost[lo] < bestCost)
+        {
+            best = simplex[lo];
+            bestCost = cost[lo];
+        }
+        return bestCost;
+    }
+};
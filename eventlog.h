@@ -0,0 +1,308 @@
+#pragma once
+//==============================================================================
+//                                Event Log
+//==============================================================================
+//
+// Streams every collision, cushion bounce and pocket to a binary file for
+// analysis afterwards, from live play or from batch runs raising millions of
+// events a second.
+//
+// Each thread that steps tables appends through its own EventLogWriter, into
+// a block of EVENT_LOG_BLOCK_RECORDS records that only it touches, so the
+// cost per event is a 32 byte copy. Only a full block goes to the EventLog,
+// which either writes it out there and then, or with a flush thread queues
+// it for that thread and hands back an empty one straight away. Blocks are
+// recycled, so once a writer has its first block nothing more is allocated.
+// If the disk falls EVENT_LOG_QUEUE_BLOCKS behind, writers wait for it rather
+// than drop records.
+//
+// Blocks from different writers land in whatever order they fill, so the
+// records of one run are in order but runs may be interleaved.
+//
+// File layout (little endian, as written by the x86/x64 builds):
+//     "POOLEVT1", record size
+//     EventRecord until end of file
+//
+//==============================================================================
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "collisionevents.h"
+
+// 1 MB blocks
+const size_t EVENT_LOG_BLOCK_RECORDS = 32768;
+
+// Full blocks the flush thread may have waiting before writers stall
+const size_t EVENT_LOG_QUEUE_BLOCKS = 8;
+
+// Ball b of a cushion or pocket record
+const unsigned char EVENT_LOG_NO_BALL = 0xFF;
+
+const char EVENT_LOG_MAGIC[8] = { 'P', 'O', 'O', 'L', 'E', 'V', 'T', '1' };
+
+
+// One event as stored on disk
+struct EventRecord
+{
+    unsigned long long step;        // Step of its run it happened in
+    unsigned run;                   // Shot or session it belongs to
+    unsigned char type;             // SIM_EVENT_BALL_HIT, SIM_EVENT_CUSHION or SIM_EVENT_POCKET
+    unsigned char a, b;
+    unsigned char reserved;
+    float x, z;
+    float speed;
+    unsigned reserved2;
+};
+
+static_assert(sizeof(EventRecord) == 32, "EventRecord is a fixed 32 bytes on disk");
+static_assert(std::is_trivially_copyable<EventRecord>::value, "EventRecord is written as raw bytes");
+
+struct EventBlock
+{
+    std::vector<EventRecord> records;
+    size_t count = 0;
+
+    EventBlock() : records(EVENT_LOG_BLOCK_RECORDS) {}
+    bool full() const { return this->count == this->records.size(); }
+};
+
+
+// The file, and the blocks on their way to it
+class EventLog
+{
+public:
+    ~EventLog() { this->close(); }
+
+    // With `background` full blocks are written by a thread of this log's own
+    bool open(const char* path, bool background)
+    {
+        this->close();
+        this->file.open(path, std::ios::binary | std::ios::trunc);
+        if (!this->file)
+        {
+            std::cout << "ERROR::EVENTLOG::CANNOT_WRITE " << path << std::endl;
+            return false;
+        }
+
+        unsigned recordSize = (unsigned)sizeof(EventRecord);
+        this->file.write(EVENT_LOG_MAGIC, sizeof(EVENT_LOG_MAGIC));
+        this->file.write((const char*)&recordSize, sizeof(recordSize));
+        this->written = 0;
+        this->stopping = false;
+        if (background)
+            this->flusher = std::thread(&EventLog::flushLoop, this);
+        return true;
+    }
+
+    bool isOpen() const { return this->file.is_open(); }
+
+    // Every writer must have flushed first
+    void close()
+    {
+        if (this->flusher.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->stopping = true;
+            }
+            this->ready.notify_one();
+            this->flusher.join();
+        }
+        if (this->file.is_open())
+        {
+            this->file.close();
+            if (this->file.fail())
+                std::cout << "ERROR::EVENTLOG::WRITE_FAILED" << std::endl;
+        }
+    }
+
+    // Records on disk, or queued for it
+    unsigned long long records() const
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->written;
+    }
+
+    // Hand over a block, which may be null or partly full, and get an empty
+    // one back
+    EventBlock* exchange(EventBlock* block)
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        if (block && this->submit(*block))
+            block = nullptr;
+        if (block)
+            return block;
+
+        while (this->spare.empty() && this->queue.size() >= EVENT_LOG_QUEUE_BLOCKS)
+            this->freed.wait(lock);
+        if (!this->spare.empty())
+        {
+            block = this->spare.back();
+            this->spare.pop_back();
+            return block;
+        }
+        this->blocks.emplace_back(new EventBlock());
+        return this->blocks.back().get();
+    }
+
+    // Hand over a writer's last block
+    void release(EventBlock* block)
+    {
+        if (!block)
+            return;
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (!this->submit(*block))
+            this->spare.push_back(block);
+    }
+
+private:
+    std::ofstream file;
+    std::thread flusher;
+    mutable std::mutex mutex;
+    std::condition_variable ready;      // A block is queued, or stopping
+    std::condition_variable freed;      // The flush thread finished a block
+
+    std::vector<std::unique_ptr<EventBlock>> blocks;
+    std::vector<EventBlock*> spare;
+    std::deque<EventBlock*> queue;
+    unsigned long long written = 0;
+    bool stopping = false;
+
+    // With the lock held. True if the flush thread now has the block,
+    // otherwise it is empty again.
+    bool submit(EventBlock& block)
+    {
+        if (!block.count)
+            return false;
+        this->written += block.count;
+        if (!this->flusher.joinable())
+        {
+            this->writeBlock(block);
+            return false;
+        }
+        this->queue.push_back(&block);
+        this->ready.notify_one();
+        return true;
+    }
+
+    void writeBlock(EventBlock& block)
+    {
+        this->file.write((const char*)block.records.data(), (std::streamsize)(block.count * sizeof(EventRecord)));
+        block.count = 0;
+    }
+
+    // The file is only touched here while the thread runs, outside the lock
+    void flushLoop()
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        for (;;)
+        {
+            this->ready.wait(lock, [this] { return this->stopping || !this->queue.empty(); });
+            if (this->queue.empty())
+                return;
+
+            EventBlock* block = this->queue.front();
+            this->queue.pop_front();
+            lock.unlock();
+            this->writeBlock(*block);
+            lock.lock();
+            this->spare.push_back(block);
+            this->freed.notify_all();
+        }
+    }
+};
+
+
+// One thread's way into an EventLog. Set `run` before each shot; records
+// are stamped with it.
+class EventLogWriter : public CollisionListener
+{
+public:
+    unsigned run = 0;
+
+    explicit EventLogWriter(EventLog& log) : log(log) {}
+
+    ~EventLogWriter() { this->flush(); }
+
+    void collided(const CollisionEvent& e) override
+    {
+        if (!this->block)
+        {
+            if (!this->log.isOpen())
+                return;
+            this->block = this->log.exchange(nullptr);
+        }
+
+        EventRecord& r = this->block->records[this->block->count++];
+        r.step = e.step;
+        r.run = this->run;
+        r.type = (unsigned char)e.type;
+        r.a = (unsigned char)e.a;
+        r.b = e.b < 0 ? EVENT_LOG_NO_BALL : (unsigned char)e.b;
+        r.reserved = 0;
+        r.x = e.x;
+        r.z = e.z;
+        r.speed = e.speed;
+        r.reserved2 = 0;
+
+        if (this->block->full())
+            this->block = this->log.exchange(this->block);
+    }
+
+    // Send what has been appended so far, before closing the log
+    void flush()
+    {
+        this->log.release(this->block);
+        this->block = nullptr;
+    }
+
+private:
+    EventLog& log;
+    EventBlock* block = nullptr;
+};
+
+
+// Reads a log back a block at a time
+class EventLogReader
+{
+public:
+    bool open(const char* path)
+    {
+        this->file.open(path, std::ios::binary);
+        if (!this->file)
+        {
+            std::cout << "ERROR::EVENTLOG::CANNOT_READ " << path << std::endl;
+            return false;
+        }
+
+        char magic[sizeof(EVENT_LOG_MAGIC)];
+        unsigned recordSize = 0;
+        this->file.read(magic, sizeof(magic));
+        this->file.read((char*)&recordSize, sizeof(recordSize));
+        if (!this->file || memcmp(magic, EVENT_LOG_MAGIC, sizeof(magic)) != 0 || recordSize != sizeof(EventRecord))
+        {
+            std::cout << "ERROR::EVENTLOG::BAD_HEADER " << path << std::endl;
+            this->file.close();
+            return false;
+        }
+        return true;
+    }
+
+    // Fills up to `max` records, 0 at the end of the file
+    size_t read(EventRecord* out, size_t max)
+    {
+        this->file.read((char*)out, (std::streamsize)(max * sizeof(EventRecord)));
+        return (size_t)this->file.gcount() / sizeof(EventRecord);
+    }
+
+private:
+    std::ifstream file;
+};
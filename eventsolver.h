@@ -0,0 +1,432 @@
+#pragma once
+//==============================================================================
+//                                Event Solver
+//==============================================================================
+//
+// Alternative to fixed stepping. Between collisions every ball follows a
+// path made of constant acceleration phases (see motion.h), so the time of
+// the next ball-ball, ball-cushion and ball-pocket event can be solved for.
+// Predictions sit in a priority queue and the solver jumps straight from one
+// event to the next, so fast balls can't tunnel through each other and long
+// runs cost nothing. The end of a phase is an event too, since predictions
+// made for one phase don't hold in the next.
+//
+// Straight line motion is solved exactly. With friction the gap between two
+// balls is a quartic in time, and its first root is found by conservative
+// advancement instead.
+//
+// Predictions are invalidated lazily: every ball carries a counter that is
+// bumped whenever its velocity changes, and an event is ignored if either
+// ball has moved on since it was predicted.
+//
+// The same response rules as the stepping simulation are used on contact.
+//
+//==============================================================================
+#include <cmath>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "simconfig.h"
+#include "balltable.h"
+#include "motion.h"
+#include "collisionevents.h"
+
+enum EventType
+{
+    EVENT_POCKET,           // Pockets win ties, as in the stepping loop
+    EVENT_CUSHION_X,        // Side cushions
+    EVENT_CUSHION_Z,        // End cushions
+    EVENT_BALL,             // Ball to ball
+    EVENT_PHASE             // Skid turns to roll, or roll to rest
+};
+
+// Gap (table units) at which conservative advancement calls it contact
+const double EVENT_CONTACT_TOLERANCE = 1e-4;
+
+// A ball hit again this soon (seconds) after its last hit bounces elastically.
+// Losing speed on every hit lets a ball wedged in a cluster bounce between
+// its neighbours without end at a single instant (inelastic collapse).
+const double EVENT_COLLAPSE_TIME = 1e-5;
+
+// Balls already touching only collide if they close faster than this (units
+// per second), so a cluster pressing against itself can't stall the solver
+const double EVENT_MIN_CLOSING = 1e-2;
+
+struct SolverEvent
+{
+    double time;
+    int type;
+    int a, b;                       // b is -1 for single ball events
+    unsigned countA, countB;        // Ball counters when predicted
+
+    // Orders the queue earliest first
+    bool operator<(const SolverEvent& other) const
+    {
+        if (this->time != other.time)
+            return this->time > other.time;
+        return this->type > other.type;
+    }
+};
+
+
+class EventSolver
+{
+public:
+    unsigned long long eventCount = 0;     // Events handled since construction
+
+    // Throw away all predictions. Needed whenever the ball table is changed
+    // from outside the solver (reset, cue strike, edits to the table).
+    void invalidate() { this->dirty = true; }
+
+    // Move the table forward exactly `duration` seconds, handling every event
+    // inside that window. Returns the SimEvent flags raised; each collision
+    // is also reported to sink, if given, stamped with the fixed step it
+    // falls in counting on from sink->step.
+    unsigned advance(BallTable& b, const SimConfig& c, double duration, const CollisionSink* sink = nullptr)
+    {
+        if (this->dirty)
+            this->rebuild(b, c);
+
+        unsigned events = SIM_EVENT_NONE;
+        const double start = this->now;
+        const double end = this->now + duration;
+        CollisionSink stamped;
+        if (sink)
+            stamped = *sink;
+
+        while (!this->queue.empty())
+        {
+            SolverEvent e = this->queue.top();
+            if (e.time > end)
+                break;
+            this->queue.pop();
+
+            if (e.countA != this->counts[e.a] || (e.b >= 0 && e.countB != this->counts[e.b]))
+                continue;   // Stale prediction
+
+            this->drift(b, c, e.time - this->now);
+            this->now = e.time;
+            if (sink)
+                stamped.step = sink->step + (unsigned long long)((e.time - start) / SIM_FIXED_DT);
+            events |= this->resolve(b, c, e, sink ? &stamped : nullptr);
+            this->eventCount++;
+
+            // Settling can also bring a ball outside the event to rest; its
+            // queued cushion and pocket events assumed it kept moving
+            for (int i = 0; i < b.count; i++)
+                this->wasMoving[i] = b.moving(i);
+            b.settle(c.sleepSpeed);
+            for (int i = 0; i < b.count; i++)
+            {
+                if (this->wasMoving[i] && !b.moving(i) && i != e.a && i != e.b)
+                {
+                    this->counts[i]++;
+                    this->predict(b, c, i);
+                }
+            }
+
+            // A pair that has just bounced may still be closing on one
+            // axis; don't let it collide again at the same instant
+            this->predict(b, c, e.a, 0, e.b);
+            if (e.b >= 0)
+                this->predict(b, c, e.b, 0, e.a);
+
+            // Stale events pile up on a busy table; start afresh now and again
+            if (this->queue.size() > (size_t)(16 * b.count * b.count + 64))
+                this->rebuild(b, c);
+        }
+
+        this->drift(b, c, end - this->now);
+        this->now = end;
+        return events;
+    }
+
+private:
+    std::priority_queue<SolverEvent> queue;
+    unsigned counts[POOL_MAX_BALLS] = {};
+    double lastHit[POOL_MAX_BALLS];            // Time of each ball's last ball hit
+    bool wasMoving[POOL_MAX_BALLS];            // Scratch for advance()
+    double now = 0.0;
+    bool dirty = true;
+
+    // Predict everything from scratch
+    void rebuild(BallTable& b, const SimConfig& c)
+    {
+        while (!this->queue.empty())
+            this->queue.pop();
+        this->now = 0.0;
+        this->dirty = false;
+
+        b.settle(c.sleepSpeed);
+        for (int i = 0; i < b.count; i++)
+        {
+            this->counts[i]++;
+            this->lastHit[i] = -HUGE_VAL;
+        }
+        for (int i = 0; i < b.count; i++)
+            this->predict(b, c, i, i + 1);
+    }
+
+    // Move every moving ball along its path
+    void drift(BallTable& b, const SimConfig& c, double dt) const
+    {
+        if (dt > 0.0)
+            advanceBalls(b, c, (float)dt);
+    }
+
+    // Queue the next events involving ball i. Ball pairs are only checked
+    // against ids from firstOther up, so a rebuild doesn't queue them twice,
+    // and an immediate hit with justHit is ignored.
+    void predict(const BallTable& b, const SimConfig& c, int i, int firstOther = 0, int justHit = -1)
+    {
+        if (b.flags[i] & BALL_POCKETED)
+            return;
+
+        const bool moving = b.moving(i);
+        const BallPhase path = this->phaseOf(b, c, i);
+        const double x = b.x[i], z = b.z[i];
+        const double vx = moving ? b.vx[i] : 0.0;
+        const double vz = moving ? b.vz[i] : 0.0;
+        const double limit = path.duration;
+
+        if (moving)
+        {
+            if (limit < HUGE_VAL)
+                this->push(this->now + limit, EVENT_PHASE, i);
+
+            // Cushions
+            double t;
+            if ((t = timeToWall(x, vx, path.ax, c.tableright, 1.0, limit)) >= 0.0) this->push(this->now + t, EVENT_CUSHION_X, i);
+            if ((t = timeToWall(x, vx, path.ax, c.tableleft, -1.0, limit)) >= 0.0) this->push(this->now + t, EVENT_CUSHION_X, i);
+            if ((t = timeToWall(z, vz, path.az, c.tablefront, 1.0, limit)) >= 0.0) this->push(this->now + t, EVENT_CUSHION_Z, i);
+            if ((t = timeToWall(z, vz, path.az, c.tableback, -1.0, limit)) >= 0.0) this->push(this->now + t, EVENT_CUSHION_Z, i);
+        }
+
+        // Pockets: first time the centre is inside a capture circle
+        const bool accelerating = path.ax != 0.0f || path.az != 0.0f;
+        const PocketSet& pockets = c.pockets;
+        for (int p = 0; p < pockets.count; p++)
+        {
+            double dx = x - pockets.x[p], dz = z - pockets.z[p];
+            double t = accelerating
+                ? timeToContact(dx, dz, vx, vz, path.ax, path.az, pockets.radius[p], limit, false)
+                : timeToCircle(dx, dz, vx, vz, pockets.radius[p]);
+            if (t >= 0.0)
+                this->push(this->now + t, EVENT_POCKET, i);
+        }
+
+        // Other balls
+        const double d = c.ballDiameter;
+        for (int j = firstOther; j < b.count; j++)
+        {
+            if (j == i || (b.flags[j] & BALL_POCKETED))
+                continue;
+            if (!moving && !b.moving(j))
+                continue;
+
+            const BallPhase other = this->phaseOf(b, c, j);
+            const double ovx = b.moving(j) ? b.vx[j] : 0.0;
+            const double ovz = b.moving(j) ? b.vz[j] : 0.0;
+            const double dax = path.ax - other.ax, daz = path.az - other.az;
+
+            // Either ball changing phase invalidates the prediction anyway
+            double t = dax != 0.0 || daz != 0.0
+                ? timeToContact(x - b.x[j], z - b.z[j], vx - ovx, vz - ovz, dax, daz, d,
+                    limit < other.duration ? limit : other.duration, true)
+                : timeOfImpact(x - b.x[j], z - b.z[j], vx - ovx, vz - ovz, d);
+
+            if (t > 0.0 || (t == 0.0 && j != justHit))
+                this->push(this->now + t, EVENT_BALL, i < j ? i : j, i < j ? j : i);
+        }
+    }
+
+    // Path of ball i from now, standing still if it's at rest
+    static BallPhase phaseOf(const BallTable& b, const SimConfig& c, int i)
+    {
+        if (b.moving(i))
+            return ballPhase(b, i, c);
+        BallPhase rest = { MOTION_REST, 0.0f, 0.0f, 0.0f, 0.0f, HUGE_VALF };
+        return rest;
+    }
+
+    void push(double time, int type, int a, int b = -1)
+    {
+        SolverEvent e;
+        e.time = time;
+        e.type = type;
+        e.a = a;
+        e.b = b;
+        e.countA = this->counts[a];
+        e.countB = b >= 0 ? this->counts[b] : 0;
+        this->queue.push(e);
+    }
+
+    // Apply an event to the table and return its SimEvent flag
+    unsigned resolve(BallTable& b, const SimConfig& c, const SolverEvent& e, const CollisionSink* sink)
+    {
+        const int i = e.a;
+        this->counts[i]++;
+
+        switch (e.type)
+        {
+        case EVENT_POCKET:
+            b.flags[i] = BALL_POCKETED;
+            if (sink)
+                sink->report(SIM_EVENT_POCKET, i, -1, b.x[i], b.z[i], std::sqrt(b.vx[i] * b.vx[i] + b.vz[i] * b.vz[i]));
+            return SIM_EVENT_POCKET;
+
+        case EVENT_CUSHION_X:
+            b.x[i] = b.vx[i] > 0 ? c.tableright : c.tableleft;
+            if (sink)
+                sink->report(SIM_EVENT_CUSHION, i, -1, b.x[i], b.z[i], std::fabs(b.vx[i]));
+            b.vx[i] *= -(1.0f - c.cushionDecayX);
+            return SIM_EVENT_CUSHION;
+
+        case EVENT_CUSHION_Z:
+            b.z[i] = b.vz[i] > 0 ? c.tablefront : c.tableback;
+            if (sink)
+                sink->report(SIM_EVENT_CUSHION, i, -1, b.x[i], b.z[i], std::fabs(b.vz[i]));
+            b.vz[i] *= -(1.0f - c.cushionDecayZ);
+            return SIM_EVENT_CUSHION;
+
+        case EVENT_PHASE:
+        {
+            // drift() normally lands on the change itself; finish it off if
+            // rounding left the ball a hair short
+            BallPhase p = ballPhase(b, i, c);
+            if (p.phase != MOTION_REST && p.duration < 1e-3f)
+                advanceBall(b, i, c, p.duration);
+            return SIM_EVENT_NONE;
+        }
+
+        default:
+        {
+            const int j = e.b;
+            this->counts[j]++;
+
+            bool repeat = this->now - this->lastHit[i] < EVENT_COLLAPSE_TIME
+                || this->now - this->lastHit[j] < EVENT_COLLAPSE_TIME;
+            this->lastHit[i] = this->lastHit[j] = this->now;
+
+            const float closing = sink ? closingSpeed(b, i, j) : 0.0f;
+            if (!ballsResponse(b, c, i, j, repeat))
+                return SIM_EVENT_NONE;
+            if (sink)
+                sink->report(SIM_EVENT_BALL_HIT, i, j, 0.5f * (b.x[i] + b.x[j]), 0.5f * (b.z[i] + b.z[j]),
+                    closing > 0.0f ? closing : 0.0f);
+            return SIM_EVENT_BALL_HIT;
+        }
+        }
+    }
+
+    // First time in [0, limit] that x + v t + a t^2 / 2 reaches wall while
+    // heading towards it (dir +1 for a wall above x, -1 below), or -1
+    static double timeToWall(double x, double v, double a, double wall, double dir, double limit)
+    {
+        double t = -1.0;
+        if (a == 0.0)
+            t = dir * v > 0.0 ? (wall - x) / v : -1.0;
+        else
+        {
+            double disc = v * v - 2.0 * a * (x - wall);
+            if (disc < 0.0)
+                return -1.0;
+            double root = std::sqrt(disc);
+            double t1 = (-v - root) / a, t2 = (-v + root) / a;
+            if (t1 > t2)
+                std::swap(t1, t2);
+
+            // Earliest crossing made while moving towards the wall
+            if (t1 >= 0.0 && dir * (v + a * t1) > 0.0)
+                t = t1;
+            else if (t2 >= 0.0 && dir * (v + a * t2) > 0.0)
+                t = t2;
+        }
+        return t >= 0.0 && t <= limit ? t : -1.0;
+    }
+
+    // First time in [0, limit] that a point at dp, moving at dv and
+    // accelerating at da, comes within radius of the origin, or -1. With
+    // closingOnly a touch only counts once they close at EVENT_MIN_CLOSING.
+    //
+    // Conservative advancement. The distance grows at the radial speed r and
+    // its rate can't drop faster than the acceleration |da| (sideways motion
+    // only ever adds to it), so the gap g can't close before
+    // g + r s - |da| s^2 / 2 = 0. Stepping by that s never overshoots the
+    // contact. While touching without closing, the soonest the pair can start
+    // to close is bounded the same way.
+    static double timeToContact(double dpx, double dpz, double dvx, double dvz,
+        double dax, double daz, double radius, double limit, bool closingOnly)
+    {
+        const double accel = std::sqrt(dax * dax + daz * daz);
+        if (accel <= 0.0)
+            return -1.0;
+        double t = 0.0;
+
+        for (int pass = 0; pass < 64; pass++)
+        {
+            double px = dpx + (dvx + 0.5 * dax * t) * t;
+            double pz = dpz + (dvz + 0.5 * daz * t) * t;
+            double vx = dvx + dax * t, vz = dvz + daz * t;
+            double dist = std::sqrt(px * px + pz * pz);
+            double gap = dist - radius;
+            double radial = dist > 0.0 ? (px * vx + pz * vz) / dist : 0.0;
+            double step;
+
+            if (gap <= EVENT_CONTACT_TOLERANCE)
+            {
+                if (!closingOnly || -radial >= EVENT_MIN_CLOSING)
+                    return t;
+                step = (radial + 2.0 * EVENT_MIN_CLOSING) / accel;   // Aim past the limit so this can't crawl
+            }
+            else
+                step = (radial + std::sqrt(radial * radial + 2.0 * accel * gap)) / accel;
+
+            t += step;
+            if (t > limit)
+                return -1.0;
+        }
+        return -1.0;
+    }
+
+    // Time until a point at dp moving at dv comes within radius of the
+    // origin, 0 if it already is, or -1 if it never does
+    static double timeToCircle(double dpx, double dpz, double dvx, double dvz, double radius)
+    {
+        double c = dpx * dpx + dpz * dpz - radius * radius;
+        if (c < 0.0)
+            return 0.0;
+
+        double b = dpx * dvx + dpz * dvz;
+        if (b >= 0.0)
+            return -1.0;
+
+        double a = dvx * dvx + dvz * dvz;
+        double disc = b * b - a * c;
+        if (disc < 0.0)
+            return -1.0;
+
+        return (-b - std::sqrt(disc)) / a;
+    }
+
+    // Time until two balls with relative position dp and velocity dv are one
+    // diameter apart, or -1 if they never close to that distance
+    static double timeOfImpact(double dpx, double dpz, double dvx, double dvz, double d)
+    {
+        double b = dpx * dvx + dpz * dvz;
+        if (b >= 0.0)
+            return -1.0;    // Separating
+
+        double c = dpx * dpx + dpz * dpz - d * d;
+        if (c <= 0.0)       // Already touching and still closing
+            return -b >= EVENT_MIN_CLOSING * std::sqrt(dpx * dpx + dpz * dpz) ? 0.0 : -1.0;
+
+        double a = dvx * dvx + dvz * dvz;
+        double disc = b * b - a * c;
+        if (disc < 0.0)
+            return -1.0;    // Miss
+
+        return (-b - std::sqrt(disc)) / a;
+    }
+};
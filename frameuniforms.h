@@ -0,0 +1,166 @@
+#pragma once
+//==============================================================================
+//                               Frame Uniforms
+//==============================================================================
+//
+// The camera and light settings every shader shares, as one std140 uniform
+// block written once a frame. Shaders declare it as
+//
+//     layout (std140) uniform Frame
+//     {
+//         mat4 view;
+//         mat4 projection;
+//         vec3 lightPos;
+//         vec3 viewPos;
+//         vec3 lightColor;
+//         vec3 lightType;
+//     };
+//
+// and attach() points their block at FRAME_UNIFORM_BINDING, so a frame's
+// upload is the same however many programs read it.
+//
+// The buffer is a ring of FRAME_UNIFORM_SLOTS blocks, persistently mapped
+// (ARB_buffer_storage), so write() is a memcpy and a glBindBufferRange.
+// Each slot is fenced once the frame that used it is submitted, and only
+// written again once the GPU has passed the fence. Without buffer storage
+// the block is orphaned and re-specified with glBufferSubData instead.
+//
+//==============================================================================
+#include <cstring>
+#include <iostream>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "shader.h"
+
+const GLuint FRAME_UNIFORM_BINDING = 0;
+
+// Frames the GPU may still be reading while the next is written
+const int FRAME_UNIFORM_SLOTS = 3;
+
+// How long write() waits for the GPU to free a slot before going ahead
+const GLuint64 FRAME_UNIFORM_WAIT_NS = 1000000000;
+
+
+// The block as std140 lays it out: each vec3 takes a 16 byte slot
+struct FrameBlock
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec4 lightPos;
+    glm::vec4 viewPos;
+    glm::vec4 lightColor;
+    glm::vec4 lightType;
+};
+
+static_assert(sizeof(FrameBlock) == 192, "FrameBlock must match the std140 layout of the Frame block");
+
+
+class FrameUniforms
+{
+public:
+    bool persistent = false;
+
+    void init()
+    {
+        GLint align = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+        this->stride = ((GLsizeiptr)sizeof(FrameBlock) + align - 1) / align * align;
+        this->persistent = (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) != 0;
+
+        glGenBuffers(1, &this->buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, this->buffer);
+        if (this->persistent)
+        {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_UNIFORM_BUFFER, this->stride * FRAME_UNIFORM_SLOTS, NULL, flags);
+            this->mapped = (char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, this->stride * FRAME_UNIFORM_SLOTS, flags);
+            if (!this->mapped)
+            {
+                std::cout << "ERROR::FRAMEUNIFORMS::MAP_FAILED" << std::endl;
+                this->persistent = false;
+                glBindBuffer(GL_UNIFORM_BUFFER, 0);
+                glDeleteBuffers(1, &this->buffer);
+                glGenBuffers(1, &this->buffer);
+                glBindBuffer(GL_UNIFORM_BUFFER, this->buffer);
+            }
+        }
+        if (!this->persistent)
+            glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameBlock), NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    // Point a shader's Frame block at the shared binding
+    void attach(const Shader& shader) const
+    {
+        GLuint block = glGetUniformBlockIndex(shader.Program, "Frame");
+        if (block == GL_INVALID_INDEX)
+        {
+            std::cout << "ERROR::FRAMEUNIFORMS::NO_FRAME_BLOCK in program " << shader.Program << std::endl;
+            return;
+        }
+        glUniformBlockBinding(shader.Program, block, FRAME_UNIFORM_BINDING);
+    }
+
+    // Once a frame, before its first draw
+    void write(const FrameBlock& frame)
+    {
+        if (!this->persistent)
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, this->buffer);
+            glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameBlock), NULL, GL_STREAM_DRAW);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameBlock), &frame);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, this->buffer);
+            return;
+        }
+
+        this->slot = (this->slot + 1) % FRAME_UNIFORM_SLOTS;
+        GLsync& fence = this->fences[this->slot];
+        if (fence)
+        {
+            if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FRAME_UNIFORM_WAIT_NS) == GL_TIMEOUT_EXPIRED)
+                std::cout << "ERROR::FRAMEUNIFORMS::WAIT_TIMED_OUT" << std::endl;
+            glDeleteSync(fence);
+            fence = 0;
+        }
+
+        const GLintptr offset = this->slot * this->stride;
+        memcpy(this->mapped + offset, &frame, sizeof(FrameBlock));
+        glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, this->buffer, offset, sizeof(FrameBlock));
+    }
+
+    // After the frame's last draw, so its slot isn't overwritten while in use
+    void fence()
+    {
+        if (this->persistent)
+            this->fences[this->slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    void destroy()
+    {
+        for (GLsync& fence : this->fences)
+        {
+            if (fence)
+                glDeleteSync(fence);
+            fence = 0;
+        }
+        if (this->mapped)
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, this->buffer);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            this->mapped = nullptr;
+        }
+        glDeleteBuffers(1, &this->buffer);
+        this->buffer = 0;
+    }
+
+private:
+    GLuint buffer = 0;
+    GLsizeiptr stride = 0;
+    char* mapped = nullptr;
+    int slot = 0;
+    GLsync fences[FRAME_UNIFORM_SLOTS] = {};
+};
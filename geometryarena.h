@@ -0,0 +1,209 @@
+#pragma once
+//==============================================================================
+//                                Geometry Arena
+//==============================================================================
+//
+// One vertex buffer and one index buffer holding every static mesh, behind a
+// single vertex array, so drawing the whole scene binds one VAO. Models are
+// add()ed while loading and build() uploads the lot. Their meshes give up
+// their own buffers and point at the arena: Mesh::VAO becomes the arena's,
+// and firstIndex and baseVertex say where the mesh sits in it.
+//
+// Each draw's model matrix is a vertex attribute (locations 3 to 6, as for
+// the instanced balls) read from a per-draw buffer, one matrix per draw. A
+// run of draws that share a shader and a texture goes to the GPU as one
+// glMultiDrawElementsIndirect, and each command's baseInstance picks its
+// matrix. That needs GL 4.3 or ARB_multi_draw_indirect and
+// ARB_base_instance. Without them each draw is a glDrawElementsBaseVertex
+// on the same VAO, with the matrix set as a constant attribute. The buffers
+// are immutable (glBufferStorage) where ARB_buffer_storage is present.
+//
+// A model in the arena can only be drawn through the RenderQueue.
+//
+//==============================================================================
+#include <iostream>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "model.h"
+
+// Most draws in one frame
+const int GEOMETRY_ARENA_DRAWS = 1024;
+
+// First of the four attribute locations the model matrix takes
+const GLuint GEOMETRY_ARENA_MODEL = 3;
+
+
+// Laid out as glMultiDrawElementsIndirect reads it
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+
+class GeometryArena
+{
+public:
+    GLuint VAO = 0;
+    bool indirect = false;      // glMultiDrawElementsIndirect is available
+
+    // Copy a model's meshes in. Only before build().
+    void add(Model& model)
+    {
+        for (Mesh& mesh : model.meshes)
+        {
+            mesh.firstIndex = (GLuint)this->indices.size();
+            mesh.baseVertex = (GLint)this->vertices.size();
+            this->vertices.insert(this->vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+            this->indices.insert(this->indices.end(), mesh.indices.begin(), mesh.indices.end());
+            this->meshes.push_back(&mesh);
+        }
+    }
+
+    void build()
+    {
+        this->indirect = (GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance)) != 0;
+        const bool immutable = (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) != 0;
+
+        glGenVertexArrays(1, &this->VAO);
+        glGenBuffers(1, &this->VBO);
+        glGenBuffers(1, &this->EBO);
+        glBindVertexArray(this->VAO);
+
+        glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
+        const GLsizeiptr vertexBytes = this->vertices.size() * sizeof(Vertex);
+        const GLsizeiptr indexBytes = this->indices.size() * sizeof(GLuint);
+        if (immutable)
+        {
+            glBufferStorage(GL_ARRAY_BUFFER, vertexBytes, this->vertices.data(), 0);
+            glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, indexBytes, this->indices.data(), 0);
+        }
+        else
+        {
+            glBufferData(GL_ARRAY_BUFFER, vertexBytes, this->vertices.data(), GL_STATIC_DRAW);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, this->indices.data(), GL_STATIC_DRAW);
+        }
+
+        // Same layout as Mesh::setupMesh
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, Normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, TexCoords));
+
+        // Model matrices, one per draw picked by baseInstance. Without
+        // indirect draws the attributes stay disabled and are set per draw.
+        if (this->indirect)
+        {
+            glGenBuffers(1, &this->modelBuffer);
+            glGenBuffers(1, &this->commandBuffer);
+            glBindBuffer(GL_ARRAY_BUFFER, this->modelBuffer);
+            glBufferData(GL_ARRAY_BUFFER, GEOMETRY_ARENA_DRAWS * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+            for (GLuint c = 0; c < 4; c++)
+            {
+                glEnableVertexAttribArray(GEOMETRY_ARENA_MODEL + c);
+                glVertexAttribPointer(GEOMETRY_ARENA_MODEL + c, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                    (GLvoid*)(c * sizeof(glm::vec4)));
+                glVertexAttribDivisor(GEOMETRY_ARENA_MODEL + c, 1);
+            }
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->commandBuffer);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, GEOMETRY_ARENA_DRAWS * sizeof(DrawElementsIndirectCommand), NULL, GL_STREAM_DRAW);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        }
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+        for (Mesh* mesh : this->meshes)
+        {
+            mesh->releaseBuffers();
+            mesh->VAO = this->VAO;
+        }
+        std::cout << "Geometry arena: " << this->meshes.size() << " meshes, " << this->vertices.size() << " vertices, "
+            << this->indices.size() << " indices, " << (this->indirect ? "multi-draw indirect" : "one call per draw") << std::endl;
+
+        std::vector<Vertex>().swap(this->vertices);
+        std::vector<GLuint>().swap(this->indices);
+    }
+
+    void destroy()
+    {
+        glDeleteVertexArrays(1, &this->VAO);
+        glDeleteBuffers(1, &this->VBO);
+        glDeleteBuffers(1, &this->EBO);
+        glDeleteBuffers(1, &this->modelBuffer);
+        glDeleteBuffers(1, &this->commandBuffer);
+        this->VAO = this->VBO = this->EBO = this->modelBuffer = this->commandBuffer = 0;
+    }
+
+    // Hand over the frame's draws, in the order they will be drawn. Command
+    // i's baseInstance must be i.
+    void upload(const DrawElementsIndirectCommand* commands, const glm::mat4* models, int count)
+    {
+        this->commands = commands;
+        this->models = models;
+        if (!this->indirect || !count)
+            return;
+
+        // Orphan last frame's buffers rather than wait for the GPU to finish with them
+        glBindBuffer(GL_ARRAY_BUFFER, this->modelBuffer);
+        glBufferData(GL_ARRAY_BUFFER, GEOMETRY_ARENA_DRAWS * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::mat4), models);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, GEOMETRY_ARENA_DRAWS * sizeof(DrawElementsIndirectCommand), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, count * sizeof(DrawElementsIndirectCommand), commands);
+    }
+
+    // Draws first to first + count - 1 of those uploaded, with the arena's
+    // VAO and the shader and texture bound. Returns the calls it took.
+    int draw(int first, int count) const
+    {
+        if (this->indirect)
+        {
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                (const GLvoid*)(first * sizeof(DrawElementsIndirectCommand)), count, 0);
+            return 1;
+        }
+
+        for (int i = first; i < first + count; i++)
+        {
+            const DrawElementsIndirectCommand& c = this->commands[i];
+            const glm::mat4& m = this->models[i];
+            for (GLuint k = 0; k < 4; k++)
+                glVertexAttrib4fv(GEOMETRY_ARENA_MODEL + k, &m[k][0]);
+            glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)c.count, GL_UNSIGNED_INT,
+                (const GLvoid*)(c.firstIndex * sizeof(GLuint)), c.baseVertex);
+        }
+        return count;
+    }
+
+    // After the frame's last draw()
+    void finish() const
+    {
+        if (this->indirect)
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+private:
+    GLuint VBO = 0, EBO = 0;
+    GLuint modelBuffer = 0;
+    GLuint commandBuffer = 0;
+
+    // Staging until build()
+    std::vector<Vertex> vertices;
+    std::vector<GLuint> indices;
+    std::vector<Mesh*> meshes;
+
+    // This frame's draws, from upload()
+    const DrawElementsIndirectCommand* commands = nullptr;
+    const glm::mat4* models = nullptr;
+};
@@ -29,6 +29,21 @@
 #include "shader.h"
 #include "camera.h"
 #include "model.h"
+#include "ballrenderer.h"
+#include "renderqueue.h"
+#include "geometryarena.h"
+#include "frameuniforms.h"
+
+// Physics
+#include "simulation.h"
+#include "tablefile.h"
+#include "replay.h"
+#include "simthread.h"
+#include "collisionconsumer.h"
+#include "eventlog.h"
+
+// Checks the draw path doesn't touch the heap
+#include "alloccounter.h"
 
 //Sound effects - Windows - comment out if this breaks on Mac
 #include<Windows.h>
@@ -62,7 +77,6 @@ GLfloat zVal = 700.0f;
 // OBJECTS
 struct objects 
 {
-    string name = "";
     GLfloat x = 0.0;
     GLfloat y = 500.0;
     GLfloat z = 0.0;
@@ -73,7 +87,22 @@ struct objects
 
     GLfloat angle = 0.0f;
     GLfloat inc = 0.001f;
-} ballObj, cueObj, cuetipObj, tableObj, ball2Obj;
+} cueObj, cuetipObj, tableObj;
+
+// Face image of each ball, by id; ball.obj gives the shape of them all
+const char* const BALL_FACES[] = { "objects/textures/1.jpg", "objects/textures/2.jpg" };
+
+// Ball physics, stepped at a fixed rate independent of the frame rate
+Simulation sim;
+
+// Session recording (--record file) and playback (--replay file)
+SessionRecorder recorder;
+SessionReplayer replayer;
+bool replaying = false;
+
+// Steps sim on its own thread once the window is up. Inputs are applied
+// there too, through the recorder so they can be replayed.
+SimThread simThread(sim, [](Simulation& s, const PlayerInput& in) { recorder.input(s, in.type, in.value, in.seconds); });
 
 // Mouse Variables
 double oldX, oldY;
@@ -84,36 +113,10 @@ bool firstMouse = false;
 GLfloat groundLevel = 0.0f;
 GLfloat tableTop = 40.0f;
 
-GLfloat tableback = -110.0f;    // Farthest away at start
-GLfloat tablefront = 110.0f;    // Closest to camera at start
-GLfloat tableleft = -45.0f;     
-GLfloat tableright = 45.0f;      
- 
-// Discover if ball 1 and ball 2 have been hit yet. Starts true for logic purposes
-bool hit = true;
-bool hit2 = true;
-
-
-// Original locations & incrementors of objects
-GLfloat OGcueZ = 50.0f;
+// Original locations of objects (ball positions live in simulation.h)
 GLfloat OGcueY = 40.0f;
 GLfloat OGcueX = -4.0f;  
 
-GLfloat OGballz = 43.0f;
-GLfloat OGballx = 0.0f;
-GLfloat OGballzinc = -2.0;
-GLfloat OGballxinc = -1.0;
-
-GLfloat OGball2z = -30.0f;
-GLfloat OGball2x = -35.0f;
-GLfloat OGball2zinc = 1.5;
-GLfloat OGball2xinc = 1.0;
-
-// Check for ball being pocketed
-bool pcketBall1 = false;
-bool pcketBall2 = false;
-bool cueHit = false;
-
 // Text on Screen
 string stringTitle = "Pockets hit (Red ball): ";
 string stringTitle2 = "Pockets hit (Black ball): ";
@@ -132,15 +135,20 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 //==============================================================================
 
 //=================== Prototype functions for modular functions ======================== 
-void tableCollision(objects& obj);
-
-void ballsCollision(objects& obj1, objects& obj2);
+void playSound(const CollisionEvent& e);
 
-void pocketCollision(objects& obj);
+void playerInput(int type, GLfloat value);
 
 void reset();
 //=======================================================================================
 
+// Collisions from the physics thread, played on a thread of their own and
+// logged there too with --events file
+CollisionQueue collisionQueue;
+EventLog eventLog;
+EventLogWriter eventWriter(eventLog);
+CollisionConsumer audio(collisionQueue, [](const CollisionEvent& e) { playSound(e); eventWriter.collided(e); });
+
 void init_Resources()
 {
     // Init GLFW
@@ -197,47 +205,135 @@ void init_Resources()
 //==============================================
 
 // The MAIN function, from here we start our application and run the loop
-int main()
+int main(int argc, char** argv)
 {
+    // A replay drives the table through its own observer, so it can't be
+    // recorded at the same time
+    bool recordArg = false, replayArg = false;
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        recordArg = recordArg || strcmp(argv[i], "--record") == 0;
+        replayArg = replayArg || strcmp(argv[i], "--replay") == 0;
+    }
+    if (recordArg && replayArg)
+    {
+        std::cout << "ERROR::REPLAY::RECORD_WHILE_REPLAYING --record and --replay can't be used together" << std::endl;
+        return 1;
+    }
+
     init_Resources();
 
     // ==============================================
     // ============ Set up our Objects ==============
     // ==============================================
+    // Table size, cushions, pockets and friction; --table picks another file
+    const char* tableFile = "objects/tables/default.table";
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (strcmp(argv[i], "--table") == 0)
+            tableFile = argv[i + 1];
+    }
+    loadTableFile(tableFile, sim.config);
     reset(); //Place objects in original locations
 
+    // Record or replay a session
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (strcmp(argv[i], "--record") == 0 && recorder.begin(argv[i + 1], sim))
+            sim.observer = &recorder;
+        if (strcmp(argv[i], "--replay") == 0 && replayer.load(argv[i + 1]))
+        {
+            replayer.start(sim);
+            replaying = true;
+        }
+        if (strcmp(argv[i], "--events") == 0)
+            eventLog.open(argv[i + 1], true);
+    }
+
     // =======================================================================
     // Shaders
     // =======================================================================
     Shader lampShader("objects/lampVertex.glsl", "objects/lampFragment.glsl");
     Shader lightShader("objects/lightVertex.glsl", "objects/lightFragment.glsl");
+    Shader aimShader("objects/aimVertex.glsl", "objects/aimFragment.glsl");
+    Shader ballShader("objects/ballVertex.glsl", "objects/ballFragment.glsl");
 
     // =======================================================================
     // Models
     // =======================================================================
-    Model ball((GLchar*)"objects/ball.obj");        // Cue ball
-    Model ball2((GLchar*)"objects/ball2.obj");      // Ball to hit
+    Model ball((GLchar*)"objects/ball.obj");        // Every ball, drawn instanced
     Model table((GLchar*)"objects/pooltable.obj");  // CREDIT: https://free3d.com/3d-model/pool-table-v1--600461.html
     Model cue((GLchar*)"objects/poolcue.obj");      // CREDIT: https://free3d.com/3d-model/pool-cue-v1--229730.html
     Model lamp((GLchar*)"objects/lamp.obj");        // CREDIT: https://free3d.com/3d-model/punct-pendant-lamp-86726.html
 
+    // The static models share one set of buffers; the balls are instanced
+    // from their own
+    GeometryArena arena;
+    arena.add(table);
+    arena.add(cue);
+    arena.add(lamp);
+    arena.build();
+
     // =======================================================================
     // Projection Matrix
     // =======================================================================
     glm::mat4 projection = glm::perspective(45.0f, (GLfloat)sWidth / (GLfloat)sHeight, 1.0f, 10000.0f);
-    
-    lightShader.Use();
-    glUniformMatrix4fv(glGetUniformLocation(lightShader.Program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
 
     // =======================================================================
     // Define how and where the data will be passed to the shaders
     // =======================================================================
-    GLint lightPos = glGetUniformLocation(lightShader.Program, "lightPos");
-    GLint viewPos = glGetUniformLocation(lightShader.Program, "viewPos");
-    GLint lightCol = glGetUniformLocation(lightShader.Program, "lightColor");
-    GLint lightType = glGetUniformLocation(lightShader.Program, "lightType");
+    // Camera and light go to every shader at once, through the Frame block
+    FrameUniforms frameUniforms;
+    frameUniforms.init();
+    frameUniforms.attach(lightShader);
+    frameUniforms.attach(ballShader);
+    frameUniforms.attach(lampShader);
+    frameUniforms.attach(aimShader);
+    FrameBlock frame;
+    frame.projection = projection;
+    frame.lightPos = glm::vec4(0.0f, 500.0f, 0.0f, 0.0f);
+    frame.viewPos = glm::vec4(0.0f);
+
+    GLint aimHeight = aimShader.Uniform("height");
+    GLint aimColor = aimShader.Uniform("lineColor");
+
+    BallRenderer balls;
+    balls.init(ball, ballShader, BALL_FACES, sizeof(BALL_FACES) / sizeof(BALL_FACES[0]));
+
+    // Draws are sorted by shader first, in this order
+    RenderQueue renderQueue;
+    const int lightPass = renderQueue.addShader(lightShader);
+    const int ballPass = renderQueue.addShader(ballShader);
+    const int lampPass = renderQueue.addShader(lampShader);
+    renderQueue.useArena(&arena);
+    unsigned long long queueDraws = 0, queueCalls = 0, queueStateChanges = 0;
+
+    // Heap allocations made while drawing, which should stay at 0
+    unsigned long long frames = 0, drawAllocations = 0;
+
+    // =======================================================================
+    // Aim preview lines: cue ball path then object ball path, each with room
+    // for a full AimLine. Uploaded only when the preview changes.
+    // =======================================================================
+    GLuint aimVAO, aimVBO;
+    unsigned aimVersion = ~0u;
+    glGenVertexArrays(1, &aimVAO);
+    glGenBuffers(1, &aimVBO);
+    glBindVertexArray(aimVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, aimVBO);
+    glBufferData(GL_ARRAY_BUFFER, 2 * sizeof(AimLine::points), NULL, GL_DYNAMIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (GLvoid*)0);
+    glBindVertexArray(0);
 
     
+    // Start the physics once loading is done. 1 ms timer resolution lets
+    // its thread wake on time for every step.
+    timeBeginPeriod(1);
+    sim.collisions.queue = &collisionQueue;
+    audio.start();
+    simThread.start();
+
     // =======================================================================
     // Iterate this block while the window is open
     // =======================================================================
@@ -245,6 +341,11 @@ int main()
     {
         // Check and call events
         glfwPollEvents();
+        const unsigned long long allocationsBefore = allocationCount();
+
+        // Newest physics state, drawn part way into its step
+        const RenderState& state = simThread.latest();
+        const float alpha = simThread.alpha(state);
 
         // Clear buffers
         glClearColor(0.8f, 0.8f, 0.8f, 1.0f);
@@ -257,23 +358,14 @@ int main()
             glm::vec3(0, 1, 0)                                      // Head is up (set to 0,-1,0 to look upside-down)
         );
 
-        // Pass the data in the variables to to go to the vertex shader
-        glUniform3f(lightPos, 0.0, 500.f, 0.0);
-        glUniform3fv(viewPos, 1, glm::value_ptr(glm::vec3(0.0f, 0.0f, 0.0f)));
-        glUniform3fv(lightCol, 1, glm::value_ptr(lightColor));
-        glUniform3fv(lightType, 1, glm::value_ptr(lightMode));
-
-        lightShader.Use();
-
-        // The View matrix first...
-        glUniformMatrix4fv(glGetUniformLocation(lightShader.Program, "view"), 1, GL_FALSE, glm::value_ptr(View));
-
-        // Update the projection matrix previously defined
-        glUniformMatrix4fv(glGetUniformLocation(lightShader.Program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+        // One upload serves every shader this frame
+        frame.view = View;
+        frame.lightColor = glm::vec4(lightColor, 0.0f);
+        frame.lightType = glm::vec4(lightMode, 0.0f);
+        frameUniforms.write(frame);
 
-        // Set up the scenery for world space
-        glm::mat4 model = glm::mat4(1.0f);
-        glUniformMatrix4fv(glGetUniformLocation(lightShader.Program, "model"), 1, GL_FALSE, glm::value_ptr(model));
+        // Everything but the aim preview is queued, then drawn sorted by state
+        renderQueue.begin(View);
 
         //==========================================================================
         // Draw the Table 
@@ -282,289 +374,158 @@ int main()
 
         tableModel = glm::scale(tableModel, glm::vec3(5.0f));
         tableModel = glm::translate(tableModel, glm::vec3(tableObj.x, tableObj.y, tableObj.z));
-
-        // The Model matrix
-        glUniformMatrix4fv(glGetUniformLocation(lightShader.Program, "model"), 1, GL_FALSE, glm::value_ptr(tableModel));
-        table.Draw(lightShader);
+        renderQueue.submit(lightPass, table, tableModel);
 
         //==========================================================================
         // Draw CUE
         //==========================================================================
-        glm::mat4 cueModel;
-        glm::mat4 cuetip;
-
-        cueModel = glm::mat4(1);
-        cuetip = glm::mat4(1);
+        glm::mat4 cueModel = glm::mat4(1);
 
         cueModel = glm::scale(cueModel, glm::vec3(5.0f));
         cueModel = glm::rotate(cueModel, 0.1f, glm::vec3(0.0, 1.0, 0.0));
-        cueModel = glm::translate(cueModel, glm::vec3(cueObj.x, cueObj.y, cueObj.z));
-
-        glUniformMatrix4fv(glGetUniformLocation(lightShader.Program, "model"), 1, GL_FALSE, glm::value_ptr(cueModel));
+        cueModel = glm::translate(cueModel, glm::vec3(cueObj.x, cueObj.y, state.cueZ));
 
         // Cue hasnt hit anything yet
-        if (!cueHit)
-            cue.Draw(lightShader);
+        if (!state.cueHit)
+            renderQueue.submit(lightPass, cue, cueModel);
 
         //==========================================================================
-        // Draw ball
+        // Draw the balls, all in one instanced call
         //==========================================================================
-        glm::mat4 ballModel, ball2Model;
-
-        // Check for cue hit on ball if cue hasnt hit anything
-        if (!cueHit)
+        // Pocketed balls are left out
+        balls.begin();
+        for (int i = 0; i < state.count; i++)
         {
-            if (cueObj.z - 2 <= ballObj.z)
-            {
-                if (hit)
-                {
-                    ballObj.z = cueObj.z - 0.01;
-                    ballObj.z += ballObj.zinc;
-                    hit = false;
-                    cueHit = true;
-                }
-            }
+            if (state.pocketed(i))
+                continue;
+            glm::mat4 ballModel = glm::scale(glm::mat4(1), glm::vec3(5.0f));
+            ballModel = glm::translate(ballModel, glm::vec3(state.ballX(i, alpha), tableTop, state.ballZ(i, alpha)));
+            balls.add(i, ballModel);
         }
-        objects* ptr = &ballObj;    // Pointer to ballObj
-        objects* ptr2 = &ball2Obj;  // Pointer to ball2Obj
-
-        // BALL 1 - Check for Pocketed Ball
-        if (!pcketBall1)
-            pocketCollision(*ptr);
+        balls.submit(renderQueue, ballPass);
 
-       // Ball 2 - Check for Pocketed Ball
-        if (!pcketBall2)
-            pocketCollision(*ptr2);         
+        //==========================================================================
+        // Draw the Lamp 
+        //==========================================================================
+        glm::mat4 lampModel = glm::mat4(1);
+        lampModel = glm::scale(lampModel, glm::vec3(0.6f));
+        lampModel = glm::translate(lampModel, glm::vec3(0.0f, 1200.0f, 0.0f));
+        renderQueue.submit(lampPass, lamp, lampModel);
 
-        // Ball 1 Check for collisions on left or right of table
-        tableCollision(*ptr); //Change ballObj values by reference
+        renderQueue.flush();
+        const RenderQueueStats& drawn = renderQueue.stats();
+        queueDraws += drawn.draws;
+        queueCalls += drawn.calls;
+        queueStateChanges += drawn.programs + drawn.textures + drawn.arrays;
 
-        // Check if ball hit came and went and commence ball movement
-        if (!hit)
+        //==========================================================================
+        // Draw the aim preview, over the table once it is drawn
+        //==========================================================================
+        const AimPath& aim = state.aim;
+        if (aim.version != aimVersion)
         {
-            ballObj.z += ballObj.zinc;
-            ballObj.x += ballObj.xinc;
+            glBindBuffer(GL_ARRAY_BUFFER, aimVBO);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, aim.cue.count * sizeof(aim.cue.points[0]), aim.cue.points);
+            glBufferSubData(GL_ARRAY_BUFFER, sizeof(AimLine::points), aim.object.count * sizeof(aim.object.points[0]), aim.object.points);
+            aimVersion = aim.version;
+        }
 
-            // Check for Ball 2 to be hit to commence movement
-            if (hit2)
+        if (aim.cue.count > 1)
+        {
+            aimShader.Use();
+            glm::mat4 aimModel = glm::scale(glm::mat4(1), glm::vec3(5.0f));
+            glUniformMatrix4fv(aimShader.ModelLoc, 1, GL_FALSE, glm::value_ptr(aimModel));
+            glUniform1f(aimHeight, tableTop);
+
+            glBindVertexArray(aimVAO);
+            glUniform3f(aimColor, 1.0f, 1.0f, 1.0f);
+            glDrawArrays(GL_LINE_STRIP, 0, aim.cue.count);
+            if (aim.object.count > 1)
             {
-                // BALL 2 - Table Collision code
-                tableCollision(*ptr2); // Change ball2Obj values by reference
-
-                ball2Obj.x += ball2Obj.xinc;
-                ball2Obj.z += ball2Obj.zinc;
+                glUniform3f(aimColor, 1.0f, 0.2f, 0.2f);
+                glDrawArrays(GL_LINE_STRIP, AIM_PREVIEW_POINTS, aim.object.count);
             }
-
-            ballsCollision(*ptr, *ptr2); // Sets ball 2 hit boolean to true to let it know to commence moving
-
-            hit = false; // reset hit
+            glBindVertexArray(0);
         }
 
-        ballModel = glm::mat4(1);        
-        ball2Model = glm::mat4(1);
-
-        ballModel = glm::scale(ballModel, glm::vec3(5.0f)); 
-        ball2Model = glm::scale(ball2Model, glm::vec3(5.0f));
-
-        ballModel = glm::translate(ballModel, glm::vec3(ballObj.x, tableTop, ballObj.z));
-        ball2Model = glm::translate(ball2Model, glm::vec3(ball2Obj.x, tableTop, ball2Obj.z));
-
-        glUniformMatrix4fv(glGetUniformLocation(lightShader.Program, "model"), 1, GL_FALSE, glm::value_ptr(ballModel));
-
-        // Draw ball if it hasnt been pocketed
-        if(!pcketBall1)
-            ball.Draw(lightShader);
-        
-        glUniformMatrix4fv(glGetUniformLocation(lightShader.Program, "model"), 1, GL_FALSE, glm::value_ptr(ball2Model));
-        
-        // Draw ball if it hasnt been pocketed
-        if (!pcketBall2)
-            ball2.Draw(lightShader);
-
-        lightShader.Use();
-
-        //==========================================================================
-        // Draw the Lamp 
-        //==========================================================================
-        lampShader.Use();
-
-        // View matrix
-        glUniformMatrix4fv(glGetUniformLocation(lampShader.Program, "view"), 1, GL_FALSE, glm::value_ptr(View));
-
-        // Projection matrix
-        glUniformMatrix4fv(glGetUniformLocation(lampShader.Program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-
-        glm::mat4 lampmodel = glm::mat4(1.0f);
-        glUniformMatrix4fv(glGetUniformLocation(lampShader.Program, "model"), 1, GL_FALSE, glm::value_ptr(lampmodel));
-
-        glm::mat4 lampModel = glm::mat4(1);
-        lampModel = glm::scale(lampModel, glm::vec3(0.6f));
-        lampModel = glm::translate(lampModel, glm::vec3(0.0f, 1200.0f, 0.0f));
-
-        glUniformMatrix4fv(glGetUniformLocation(lampShader.Program, "model"), 1, GL_FALSE, glm::value_ptr(lampModel));
+        // This frame's uniform block is free again once the GPU gets past here
+        frameUniforms.fence();
 
-        // Display Lamp
-        lamp.Draw(lampShader);
+        // Report the first frame that allocates, and the total at exit
+        const unsigned long long allocated = allocationCount() - allocationsBefore;
+        if (allocated && !drawAllocations)
+            std::cout << "ERROR::RENDER::DRAW_ALLOCATED " << allocated << " allocations in frame " << frames << std::endl;
+        drawAllocations += allocated;
+        frames++;
 
         // Swap the buffers
         glfwSwapBuffers(window);
     }
 
 
+    std::cout << "Draw path: " << drawAllocations << " heap allocations in " << frames << " frames" << std::endl;
+    if (frames)
+        std::cout << "Render queue: " << (double)queueDraws / frames << " draws in " << (double)queueCalls / frames << " calls and "
+            << (double)queueStateChanges / frames << " shader, texture and vertex array binds a frame" << std::endl;
+    simThread.stop();
+    if (replaying)
+    {
+        if (replayer.divergedAt >= 0)
+            std::cout << "Replay diverged at step " << replayer.divergedAt << std::endl;
+        else if (replayer.finished(sim))
+            std::cout << "Replay matches the recording" << std::endl;
+        else
+            std::cout << "Replay stopped after " << replayer.stepsDone(sim) << " of " << replayer.hashes.size()
+                << " steps, matching so far" << std::endl;
+    }
+    audio.stop();
+    eventWriter.flush();
+    eventLog.close();
+    timeEndPeriod(1);
+    balls.destroy();
+    arena.destroy();
+    frameUniforms.destroy();
+    glDeleteVertexArrays(1, &aimVAO);
+    glDeleteBuffers(1, &aimVBO);
+    recorder.end();
     glfwTerminate();
     return 0;
 }
 
 //=====================  Modular Functions  ===============================
-void tableCollision(objects& obj)
-{
-    // Check for collisions left or right of table
-    if (obj.x >= tableright || obj.x <= tableleft)
-    {
-        obj.xinc *= -1;
-
-        if (obj.x > 0)
-            obj.x = tableright;
-        if (obj.x < 0)
-            obj.x = tableleft;
-
-        // Decay movement of ball
-        if (obj.xinc < 0)
-            obj.xinc = obj.xinc + (obj.xinc * 0.28);
-        if (obj.xinc > 0)
-            obj.xinc = obj.xinc - (obj.xinc * 0.28);
-    }
-    // Check for collisions front or back of table
-    if (obj.z >= tablefront || obj.z <= tableback)
-    {
-        obj.zinc *= -1;
-
-        if (obj.z > 0)
-            obj.z = tablefront;
-        if (obj.z < 0)
-            obj.z = tableback;
-
-        // Decay movement of ball
-        if (obj.zinc < 0)
-            obj.zinc = obj.zinc + (obj.zinc * 0.30);
-        if (obj.zinc > 0)
-            obj.zinc = obj.zinc - (obj.zinc * 0.30);
-    }
-}
-
-void ballsCollision(objects& obj1, objects& obj2)
+// Runs on the audio thread. sndPlaySound has one voice: a pocket always cuts
+// in, a ball hit only plays if nothing else is, and taps too soft to hear
+// are skipped so they don't hold the voice.
+void playSound(const CollisionEvent& e)
 {
-    GLfloat xdif = obj1.x - obj2.x;
-    GLfloat zdif = obj1.z - obj2.z;
-    GLfloat ydif = obj1.y - obj2.y;
-
-    // Check if a ball has been pocketed
-    if ((pcketBall1) || (pcketBall2))
-    {
-        // Do nothing because there is only one ball
-    }
-    else // Check for collision since both balls still exist
-    {  
-        if (sqrt((xdif * xdif) + (ydif * ydif) + (zdif * zdif)) < 5)
-        {
-            // Once collided, repel and swap speed of translation.
-            GLfloat temp = obj2.xinc;
-            obj2.xinc = (obj2.xinc * 0.90) * -1;
-            obj1.xinc = (obj1.xinc * 0.85) * -1;
-
-            temp = obj2.zinc;
-            obj2.zinc = (obj2.zinc * 0.85) * -1;
-            obj1.zinc = (obj1.zinc * 0.80) * -1;
+    const float quietestHit = 5.0f;     // Units per second
 
-            hit2 = true;
-
-            //Plays noise on windows
-            sndPlaySound(TEXT("audio/poolbreak.wav"), SND_ASYNC);
-        }
-    }
+    //Plays noise on windows
+    if (e.type == SIM_EVENT_POCKET)
+        sndPlaySound(TEXT("audio/poolpocket.wav"), SND_ASYNC);
+    else if (e.type == SIM_EVENT_BALL_HIT && e.speed >= quietestHit)
+        sndPlaySound(TEXT("audio/poolbreak.wav"), SND_ASYNC | SND_NOSTOP);
 }
 
-void pocketCollision(objects& obj)
+// Every input that moves the physics goes through here so it can be recorded.
+// Live input is ignored while a recording plays back.
+void playerInput(int type, GLfloat value)
 {
-    if ((obj.x >= tableright - 5) && (obj.z <= tableback + 5))                                          // back (farthest away) right hole
-    {
-        if (obj.name == "ball1") pcketBall1 = true;
-        else if (obj.name == "ball2") pcketBall2 = true;
-        // cout << "Hit back right pocket " << obj.x << " " << obj.y << " " << obj.z << endl; 
-
-        //Plays noise on windows
-        sndPlaySound(TEXT("audio/poolpocket.wav"), SND_ASYNC);
-    }
-    if ((obj.x <= tableleft + 5) && (obj.z <= tableback + 5))                                           // back (farthest away) left hole
-    {
-        if (obj.name == "ball1") pcketBall1 = true;
-        else if (obj.name == "ball2") pcketBall2 = true;
-        // cout << "Hit back left pocket " << obj.x << " " << obj.y << " " << obj.z << endl;
-
-        //Plays noise on windows
-        sndPlaySound(TEXT("audio/poolpocket.wav"), SND_ASYNC);
-    }
-    if (((obj.x >= tableright) || (obj.x <= tableleft)) && ((obj.z >= 0 - 2) && (obj.z <= 0 + 2)))      // Center Hole
-    {
-        if (obj.name == "ball1") pcketBall1 = true;
-        else if (obj.name == "ball2") pcketBall2 = true;
-        // cout << "Hit center left or right pocket " << obj.x << " " << obj.y << " " << obj.z << endl;
-
-        //Plays noise on windows
-        sndPlaySound(TEXT("audio/poolpocket.wav"), SND_ASYNC);
-    }
-    if ((obj.x >= tableright - 5) && (obj.z >= tablefront - 5))                                         // front right hole
-    {
-        if (obj.name == "ball1") pcketBall1 = true;
-        else if (obj.name == "ball2") pcketBall2 = true;
-        // cout << "Hit front right pocket " << obj.x << " " << obj.y << " " << obj.z << endl;
-
-        //Plays noise on windows
-        sndPlaySound(TEXT("audio/poolpocket.wav"), SND_ASYNC);
-    }
-    if ((obj.x <= tableleft + 5) && (obj.z >= tablefront - 5))                                          // front left hole
-    {
-        if (obj.name == "ball1") pcketBall1 = true;
-        else if (obj.name == "ball2") pcketBall2 = true;
-        // cout << "Hit front left pocket " << obj.x << " " << obj.y << " " << obj.z << endl;
-
-        //Plays noise on windows
-        sndPlaySound(TEXT("audio/poolpocket.wav"), SND_ASYNC);
-    }
+    if (!replaying)
+        simThread.input(PlayerInput{ type, value, (float)glfwGetTime() });
 }
 
 void reset()
 {
-    // Start drawing balls again
-    pcketBall1 = false;
-    pcketBall2 = false;
-    cueHit = false;
+    // Balls, cue and pocketed state go back to the start
+    playerInput(INPUT_RESET, 0.0f);
 
     camLocation = originalLocation;
     tableObj.y = 0; // Reset Table Y Axis Since its sitting on the floor
 
-    ballObj.z = OGballz;
-    ballObj.x = OGballx;
-    ballObj.zinc = OGballzinc;
-    ballObj.xinc = OGballxinc;
-
-    ball2Obj.z = OGball2z;
-    ball2Obj.x = OGball2x;
-    ball2Obj.zinc = OGball2zinc;
-    ball2Obj.xinc = OGball2xinc;
-
-    hit = true;
-    hit2 = false;
-
     // cue
-    cueObj.z = OGcueZ;
     cueObj.y = OGcueY;
     cueObj.x = OGcueX;
-    cueObj.zinc = -0.001;
-
-    // Give the objects identities
-    ballObj.name = "ball1";
-    ball2Obj.name = "ball2";
 }
 //=========================================================================
 
@@ -628,24 +589,24 @@ void clicked_callback(GLFWwindow* window, int button, int  action, int mode)
 
         // cout << "Old x[" << oldX << "]y[" << oldY << "] - >New x[" << xpos << "]y[" << ypos << "]" << endl;
 
-        cueObj.z -= mouseMove / 2;
+        playerInput(INPUT_MOVE_CUE, -(GLfloat)(mouseMove / 2));
     }
     if (button == GLFW_MOUSE_BUTTON_LEFT &&  action == GLFW_RELEASE) // Mouse Release
     {
         glfwGetCursorPos(window, &xpos, &ypos);
 
         if (ypos > oldY) // mouse dragged foward so push forward cue
-                cueObj.z += 2.0f;
+                playerInput(INPUT_MOVE_CUE, 2.0f);
         if ((ypos < oldY)) // mouse dragged backward so pull back cue
-                cueObj.z -= 2.0f;
+                playerInput(INPUT_MOVE_CUE, -2.0f);
         else if (ypos == oldY) // Mouse just clicked
-            cueObj.z -= 2.0f;
+            playerInput(INPUT_MOVE_CUE, -2.0f);
 
         // cout << "Released : Cursor Position at (" << xpos << " : " << ypos << ")" << endl;
     }
     if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_RELEASE) //Mouse Release
     {
-        cueObj.z += 2.0f;
+        playerInput(INPUT_MOVE_CUE, 2.0f);
     }
 }
 
@@ -44,8 +44,14 @@ public:
     vector<Texture> textures;
     GLuint VAO;
 
+    // Where the mesh starts in its buffers; both 0 unless it was moved into a
+    // GeometryArena, whose VAO it then shares
+    GLuint firstIndex;
+    GLint baseVertex;
+
     Mesh(vector<Vertex>, vector<GLuint>, vector<Texture>);      // Constructor
-    void Draw(Shader);                                          // Render the mesh
+    void Draw(const Shader&) const;                             // Render the mesh
+    void releaseBuffers();                                      // Delete the mesh's own VAO and buffers
 };
 
 
@@ -56,6 +62,8 @@ Mesh::Mesh(vector<Vertex> vertices, vector<GLuint> indices, vector<Texture> text
     this->vertices = vertices;
     this->indices = indices;
     this->textures = textures;
+    this->firstIndex = 0;
+    this->baseVertex = 0;
 
     // Now that we have all the required data, set the vertex buffers and its attribute pointers.
     this->setupMesh();
@@ -63,29 +71,24 @@ Mesh::Mesh(vector<Vertex> vertices, vector<GLuint> indices, vector<Texture> text
 
 
 
-void Mesh::Draw(Shader shader)
+// Allocates nothing: sampler locations come from the shader's cache
+void Mesh::Draw(const Shader& shader) const
 {
     // Bind appropriate textures
-    GLuint diffuseNr = 1;
-    GLuint specularNr = 1;
+    GLuint diffuseNr = 0;
+    GLuint specularNr = 0;
     for (GLuint i = 0; i < this->textures.size(); i++)
     {
         glActiveTexture(GL_TEXTURE0 + i); // Activate proper texture unit before binding
 
-        // Retrieve texture number (the N in diffuse_textureN)
-        stringstream ss;
-        string number;
-        string name = this->textures[i].type;
-
-        if (name == "texture_diffuse")
-            ss << diffuseNr++;                  // Transfer GLuint to stream
-        else if (name == "texture_specular")
-            ss << specularNr++;             // Transfer GLuint to stream
-
-        number = ss.str();
-
-        // Now set the sampler to the correct texture unit
-        glUniform1f(glGetUniformLocation(shader.Program, (name + number).c_str()), i);
+        // Point the sampler for the Nth texture of its kind (texture_diffuseN) at this unit
+        const string& name = this->textures[i].type;
+        GLint location = -1;
+        if (name == "texture_diffuse" && diffuseNr < SHADER_MAX_SAMPLERS)
+            location = shader.DiffuseLoc[diffuseNr++];
+        else if (name == "texture_specular" && specularNr < SHADER_MAX_SAMPLERS)
+            location = shader.SpecularLoc[specularNr++];
+        glUniform1i(location, i);
 
         // And finally bind the texture
         glBindTexture(GL_TEXTURE_2D, this->textures[i].id);
@@ -107,6 +110,17 @@ void Mesh::Draw(Shader shader)
 
 
 
+// Once the data lives elsewhere, e.g. in a GeometryArena
+void Mesh::releaseBuffers()
+{
+    glDeleteVertexArrays(1, &this->VAO);
+    glDeleteBuffers(1, &this->VBO);
+    glDeleteBuffers(1, &this->EBO);
+    this->VAO = this->VBO = this->EBO = 0;
+}
+
+
+
 // Initializes all the buffer objects/arrays
 void Mesh::setupMesh()
 {
@@ -47,7 +47,7 @@ public:
     }
 
     // Draws the model, and thus all its meshes
-    void Draw(Shader shader)
+    void Draw(const Shader& shader) const
     {
         for (GLuint i = 0; i < this->meshes.size(); i++)
             this->meshes[i].Draw(shader);
@@ -0,0 +1,212 @@
+#pragma once
+//==============================================================================
+//                                Motion
+//==============================================================================
+//
+// How a ball travels over the cloth between collisions, and what happens when
+// two balls meet.
+//
+// Besides its velocity every ball carries the velocity its spin alone would
+// give it (rx, rz: spin times radius). While the two differ the ball skids:
+// sliding friction pulls velocity and spin together at constant rates, so
+// the skid ends at a time known in advance. From then on the ball rolls and
+// rolling friction slows it to a stop, again at a constant rate.
+//
+// Each phase has a constant acceleration, so where a ball will be at any
+// later time is a closed form quadratic. advanceBall() jumps straight there
+// however far ahead that is, and the event solver can predict collisions
+// without stepping.
+//
+// With both friction settings at zero balls keep their speed between
+// collisions, as in the original game.
+//
+//==============================================================================
+#include <cmath>
+
+#include "simconfig.h"
+#include "balltable.h"
+
+enum MotionPhase
+{
+    MOTION_REST,
+    MOTION_ROLLING,
+    MOTION_SLIDING
+};
+
+// Speeds below this (units per second) count as zero
+const float MOTION_EPSILON = 1e-4f;
+
+
+// Constant acceleration stretch of a ball's path
+struct BallPhase
+{
+    int phase;
+    float ax, az;           // Acceleration of the ball
+    float spinAx, spinAz;   // Acceleration of rx, rz
+    float duration;         // Seconds until the next phase, HUGE_VALF if never
+};
+
+// The phase ball i is in right now
+inline BallPhase ballPhase(const BallTable& b, int i, const SimConfig& c)
+{
+    BallPhase p = { MOTION_REST, 0.0f, 0.0f, 0.0f, 0.0f, HUGE_VALF };
+    const float vx = b.vx[i], vz = b.vz[i];
+
+    // Skidding: friction acts against the slip of the contact point. The
+    // slip keeps its direction and shrinks at 7/2 the friction (solid ball).
+    const float ux = vx - b.rx[i], uz = vz - b.rz[i];
+    const float slip = std::sqrt(ux * ux + uz * uz);
+    if (c.slideFriction > 0.0f && slip > MOTION_EPSILON)
+    {
+        const float fx = c.slideFriction * ux / slip;
+        const float fz = c.slideFriction * uz / slip;
+        p.phase = MOTION_SLIDING;
+        p.ax = -fx;
+        p.az = -fz;
+        p.spinAx = 2.5f * fx;
+        p.spinAz = 2.5f * fz;
+        p.duration = slip / (3.5f * c.slideFriction);
+        return p;
+    }
+
+    const float speed = std::sqrt(vx * vx + vz * vz);
+    if (speed <= MOTION_EPSILON)
+        return p;
+
+    // Rolling: velocity and spin slow down together until the ball stops
+    p.phase = MOTION_ROLLING;
+    if (c.rollFriction > 0.0f)
+    {
+        p.ax = p.spinAx = -c.rollFriction * vx / speed;
+        p.az = p.spinAz = -c.rollFriction * vz / speed;
+        p.duration = speed / c.rollFriction;
+    }
+    return p;
+}
+
+// Move ball i forward t seconds along its path, through any phase changes
+inline void advanceBall(BallTable& b, int i, const SimConfig& c, float t)
+{
+    // Skid, roll, stop: never more than three phases
+    for (int pass = 0; pass < 3 && t > 0.0f; pass++)
+    {
+        BallPhase p = ballPhase(b, i, c);
+        if (p.phase == MOTION_REST)
+        {
+            b.flags[i] &= (unsigned char)~BALL_MOVING;
+            return;
+        }
+
+        const bool ends = p.duration <= t;
+        const float span = ends ? p.duration : t;
+
+        b.x[i] += (b.vx[i] + 0.5f * p.ax * span) * span;
+        b.z[i] += (b.vz[i] + 0.5f * p.az * span) * span;
+        b.vx[i] += p.ax * span;
+        b.vz[i] += p.az * span;
+        b.rx[i] += p.spinAx * span;
+        b.rz[i] += p.spinAz * span;
+
+        // Land exactly on the next phase rather than rounding past it
+        if (ends && p.phase == MOTION_SLIDING)
+        {
+            b.rx[i] = b.vx[i];
+            b.rz[i] = b.vz[i];
+        }
+        else if (ends)
+        {
+            b.vx[i] = b.vz[i] = 0.0f;
+            b.rx[i] = b.rz[i] = 0.0f;
+            b.flags[i] &= (unsigned char)~BALL_MOVING;
+        }
+        t -= span;
+    }
+}
+
+// Move every moving ball among the first n slots forward t seconds
+inline void advanceBalls(BallTable& b, const SimConfig& c, float t, int n)
+{
+    // No friction is plain straight lines, which vectorizes
+    if (c.slideFriction <= 0.0f && c.rollFriction <= 0.0f)
+    {
+        b.integrate(t, n);
+        return;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        if (b.flags[i] & BALL_MOVING)
+            advanceBall(b, i, c, t);
+    }
+}
+
+inline void advanceBalls(BallTable& b, const SimConfig& c, float t)
+{
+    advanceBalls(b, c, t, b.count);
+}
+
+
+// Speed at which balls i and j close along the line of centres, negative if
+// they are moving apart. A resting ball counts as still.
+inline float closingSpeed(const BallTable& b, int i, int j)
+{
+    float nx = b.x[j] - b.x[i];
+    float nz = b.z[j] - b.z[i];
+    float length = std::sqrt(nx * nx + nz * nz);
+    if (length <= 0.0f)
+        return 0.0f;
+
+    float vx = (b.moving(i) ? b.vx[i] : 0.0f) - (b.moving(j) ? b.vx[j] : 0.0f);
+    float vz = (b.moving(i) ? b.vz[i] : 0.0f) - (b.moving(j) ? b.vz[j] : 0.0f);
+    return (vx * nx + vz * nz) / length;
+}
+
+// Once collided, repel the two balls. The lower id is treated as the
+// striker. When ballRestitution > 0, returns false and leaves them alone if
+// they were already moving apart, and elastic ignores the restitution
+// setting to keep all the speed along the line of centres. The original
+// keep-factor rule (ballRestitution 0) always reverses both and returns true.
+inline bool ballsResponse(BallTable& b, const SimConfig& c, int obj1, int obj2, bool elastic = false)
+{
+    if (c.ballRestitution > 0.0f)
+    {
+        // A resting ball may still hold the speed it was put to sleep with
+        // (see BallTable::settle); here it has none
+        if (!(b.flags[obj1] & BALL_MOVING))
+            b.vx[obj1] = b.vz[obj1] = 0.0f;
+        if (!(b.flags[obj2] & BALL_MOVING))
+            b.vx[obj2] = b.vz[obj2] = 0.0f;
+
+        // Equal masses: swap the share of velocity along the line of centres
+        float nx = b.x[obj2] - b.x[obj1];
+        float nz = b.z[obj2] - b.z[obj1];
+        float length = std::sqrt(nx * nx + nz * nz);
+        if (length <= 0.0f)
+            return false;
+        nx /= length;
+        nz /= length;
+
+        float closing = (b.vx[obj1] - b.vx[obj2]) * nx + (b.vz[obj1] - b.vz[obj2]) * nz;
+        if (closing <= 0.0f)
+            return false;
+
+        float restitution = elastic ? 1.0f : c.ballRestitution;
+        float impulse = 0.5f * (1.0f + restitution) * closing;
+        b.vx[obj1] -= impulse * nx;
+        b.vz[obj1] -= impulse * nz;
+        b.vx[obj2] += impulse * nx;
+        b.vz[obj2] += impulse * nz;
+    }
+    else
+    {
+        // Original rule: reverse each ball and keep a fixed share of its speed
+        b.vx[obj2] *= -c.struckKeepX;
+        b.vx[obj1] *= -c.strikerKeepX;
+        b.vz[obj2] *= -c.struckKeepZ;
+        b.vz[obj1] *= -c.strikerKeepZ;
+    }
+
+    b.flags[obj1] |= BALL_MOVING;
+    b.flags[obj2] |= BALL_MOVING;
+    return true;
+}
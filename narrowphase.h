@@ -0,0 +1,188 @@
+#pragma once
+//==============================================================================
+//                                Narrowphase
+//==============================================================================
+//
+// Exact contact test for the candidates the broadphase hands over. One ball
+// is compared against up to 8 others at once on squared distance (no sqrt),
+// and the ids of the ones it touches are written out as a compact list.
+//
+// Three kernels, picked once at start up from what the CPU supports:
+//     AVX2  - 8 candidates per pass, positions fetched with gathers
+//     SSE2  - 4 candidates per pass
+//     Scalar fallback for anything else
+//
+//==============================================================================
+#include "balltable.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define POOL_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define POOL_TARGET_AVX2
+#define POOL_TARGET_SSE2
+#else
+#include <cpuid.h>
+#define POOL_TARGET_AVX2 __attribute__((target("avx2")))
+#define POOL_TARGET_SSE2 __attribute__((target("sse2")))
+#endif
+#endif
+
+// Write the ids from `ids` within diameter of ball a to `hits`, return how many
+typedef int (*ContactKernel)(const BallTable& b, int a, const int* ids, int count, float diameter2, int* hits);
+
+
+inline int contactsScalar(const BallTable& b, int a, const int* ids, int count, float diameter2, int* hits)
+{
+    const float ax = b.x[a], az = b.z[a];
+    int n = 0;
+    for (int k = 0; k < count; k++)
+    {
+        float dx = b.x[ids[k]] - ax;
+        float dz = b.z[ids[k]] - az;
+        hits[n] = ids[k];
+        n += (dx * dx + dz * dz) < diameter2;
+    }
+    return n;
+}
+
+#ifdef POOL_X86
+POOL_TARGET_SSE2 inline int contactsSSE2(const BallTable& b, int a, const int* ids, int count, float diameter2, int* hits)
+{
+    const __m128 ax = _mm_set1_ps(b.x[a]);
+    const __m128 az = _mm_set1_ps(b.z[a]);
+    const __m128 d2 = _mm_set1_ps(diameter2);
+    int n = 0;
+
+    for (int base = 0; base < count; base += 4)
+    {
+        // Pad a short last block with ball a; those lanes are masked off below
+        int lane[4];
+        for (int k = 0; k < 4; k++)
+            lane[k] = base + k < count ? ids[base + k] : a;
+
+        __m128 dx = _mm_sub_ps(_mm_set_ps(b.x[lane[3]], b.x[lane[2]], b.x[lane[1]], b.x[lane[0]]), ax);
+        __m128 dz = _mm_sub_ps(_mm_set_ps(b.z[lane[3]], b.z[lane[2]], b.z[lane[1]], b.z[lane[0]]), az);
+        __m128 dist2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dz, dz));
+
+        int valid = count - base >= 4 ? 0xF : (1 << (count - base)) - 1;
+        int mask = _mm_movemask_ps(_mm_cmplt_ps(dist2, d2)) & valid;
+        for (int k = 0; k < 4; k++)
+        {
+            hits[n] = lane[k];
+            n += (mask >> k) & 1;
+        }
+    }
+    return n;
+}
+
+POOL_TARGET_AVX2 inline int contactsAVX2(const BallTable& b, int a, const int* ids, int count, float diameter2, int* hits)
+{
+    const __m256 ax = _mm256_set1_ps(b.x[a]);
+    const __m256 az = _mm256_set1_ps(b.z[a]);
+    const __m256 d2 = _mm256_set1_ps(diameter2);
+    int n = 0;
+
+    for (int base = 0; base < count; base += 8)
+    {
+        int lane[8];
+        for (int k = 0; k < 8; k++)
+            lane[k] = base + k < count ? ids[base + k] : a;
+
+        __m256i idx = _mm256_loadu_si256((const __m256i*)lane);
+        __m256 dx = _mm256_sub_ps(_mm256_i32gather_ps(b.x, idx, 4), ax);
+        __m256 dz = _mm256_sub_ps(_mm256_i32gather_ps(b.z, idx, 4), az);
+        __m256 dist2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dz, dz));
+
+        int valid = count - base >= 8 ? 0xFF : (1 << (count - base)) - 1;
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(dist2, d2, _CMP_LT_OQ)) & valid;
+        for (int k = 0; k < 8; k++)
+        {
+            hits[n] = lane[k];
+            n += (mask >> k) & 1;
+        }
+    }
+    return n;
+}
+
+// AVX2 needs the CPU flag and the OS saving the wide registers
+inline bool cpuHasAVX2()
+{
+    unsigned r1[4], r7[4];
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    for (int i = 0; i < 4; i++) r1[i] = (unsigned)info[i];
+    __cpuidex(info, 7, 0);
+    for (int i = 0; i < 4; i++) r7[i] = (unsigned)info[i];
+#else
+    if (__get_cpuid_max(0, 0) < 7)
+        return false;
+    __cpuid(1, r1[0], r1[1], r1[2], r1[3]);
+    __cpuid_count(7, 0, r7[0], r7[1], r7[2], r7[3]);
+#endif
+    bool osxsave = (r1[2] & (1u << 27)) != 0;
+    bool avx = (r1[2] & (1u << 28)) != 0;
+    bool avx2 = (r7[1] & (1u << 5)) != 0;
+    if (!(osxsave && avx && avx2))
+        return false;
+
+#ifdef _MSC_VER
+    unsigned long long xcr0 = _xgetbv(0);
+#else
+    unsigned lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    unsigned long long xcr0 = ((unsigned long long)hi << 32) | lo;
+#endif
+    return (xcr0 & 6) == 6;
+}
+
+inline bool cpuHasSSE2()
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    return true;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    unsigned r[4];
+    __cpuid(1, r[0], r[1], r[2], r[3]);
+    return (r[3] & (1u << 26)) != 0;
+#endif
+}
+#endif
+
+
+enum ContactPath
+{
+    CONTACT_SCALAR,
+    CONTACT_SSE2,
+    CONTACT_AVX2
+};
+
+// Best kernel this machine can run, worked out on first use
+inline ContactPath detectContactPath()
+{
+#ifdef POOL_X86
+    static const ContactPath best = cpuHasAVX2() ? CONTACT_AVX2 : (cpuHasSSE2() ? CONTACT_SSE2 : CONTACT_SCALAR);
+    return best;
+#else
+    return CONTACT_SCALAR;
+#endif
+}
+
+inline ContactKernel contactKernel(ContactPath path)
+{
+#ifdef POOL_X86
+    if (path == CONTACT_AVX2)
+        return contactsAVX2;
+    if (path == CONTACT_SSE2)
+        return contactsSSE2;
+#endif
+    return contactsScalar;
+}
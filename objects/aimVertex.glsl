@@ -0,0 +1,22 @@
+#version 330 core
+layout (location = 0) in vec2 point;
+
+// Shared by every shader, written once a frame (see frameuniforms.h)
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    vec3 lightPos;
+    vec3 viewPos;
+    vec3 lightColor;
+    vec3 lightType;
+};
+
+uniform mat4 model;
+uniform float height;
+
+// Points are table (x, z), drawn at the height of the ball centres
+void main()
+{
+    gl_Position = projection * view * model * vec4(point.x, height, point.y, 1.0f);
+}
@@ -0,0 +1,59 @@
+#version 330 core
+out vec4 color;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+flat in float Layer;
+
+
+// Shared by every shader, written once a frame (see frameuniforms.h)
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    vec3 lightPos;
+    vec3 viewPos;
+    vec3 lightColor;
+    vec3 lightType;
+};
+
+uniform sampler2DArray faces;      // One layer per ball face image
+
+
+void main()
+{
+    // Ambient
+    float ambientStrength = 0.8f;
+    vec3 ambient = ambientStrength * lightColor;
+
+    // Diffuse
+    vec3 norm = normalize(Normal);
+    vec3 lightDir = normalize(lightPos - FragPos);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = diff * lightColor;
+    
+    // Specular
+    float specularStrength = 0.5f;
+    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
+    vec3 specular = specularStrength * spec * lightColor;
+   
+    
+    vec4 result;
+    
+    if (lightType.x == 0)
+        result = vec4(0.0f);
+    if (lightType.x == 1)
+        result = vec4(ambient, 1.0f);
+    if (lightType.x == 2)
+        result = vec4(diffuse, 1.0f);
+    if (lightType.x == 3)
+        result = vec4(specular, 1.0f);
+    if (lightType.x == 4)
+        result = vec4((ambient + diffuse + specular), 1.0f);
+
+    color = texture(faces, vec3(TexCoords, Layer)) * result;
+
+}
@@ -0,0 +1,33 @@
+#version 330 core
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec2 texCoords;
+
+// Per ball, from the instance buffer (see ballrenderer.h)
+layout (location = 3) in mat4 model;
+layout (location = 7) in float layer;
+
+out vec3 Normal;
+out vec3 FragPos;
+out vec2 TexCoords;
+flat out float Layer;
+
+// Shared by every shader, written once a frame (see frameuniforms.h)
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    vec3 lightPos;
+    vec3 viewPos;
+    vec3 lightColor;
+    vec3 lightType;
+};
+
+void main()
+{
+    gl_Position = projection * view *  model * vec4(position, 1.0f);
+    FragPos = vec3(model * vec4(position, 1.0f));
+    Normal = mat3(transpose(inverse(model))) * normal;
+    TexCoords = texCoords;
+    Layer = layer;
+}
@@ -2,11 +2,21 @@
 layout (location = 0) in vec3 position;
 layout (location = 2) in vec2 texCoords;
 
+// Per draw (see renderqueue.h)
+layout (location = 3) in mat4 model;
+
 out vec2 TexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
+// Shared by every shader, written once a frame (see frameuniforms.h)
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    vec3 lightPos;
+    vec3 viewPos;
+    vec3 lightColor;
+    vec3 lightType;
+};
 
 void main()
 {
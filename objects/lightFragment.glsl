@@ -6,11 +6,16 @@ in vec3 Normal;
 in vec2 TexCoords;
 
 
-uniform vec3 lightPos;
-uniform vec3 viewPos;
-uniform vec3 lightColor;
-//uniform vec3 objectColor;
-uniform vec3 lightType;
+// Shared by every shader, written once a frame (see frameuniforms.h)
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    vec3 lightPos;
+    vec3 viewPos;
+    vec3 lightColor;
+    vec3 lightType;
+};
 
 uniform sampler2D texture_diffuse1; //??
 
@@ -0,0 +1,97 @@
+#pragma once
+//==============================================================================
+//                                Pockets
+//==============================================================================
+//
+// Pockets are capture circles on the cloth: a ball whose centre gets inside
+// one drops. Tables describe their own set (see objects/tables/*.table), so a
+// different layout or table size needs no recompiling.
+//
+// capture() checks every ball against every pocket in one branch free pass
+// and returns a bitmask of the balls that dropped.
+//
+//==============================================================================
+#include "balltable.h"
+
+const int POOL_MAX_POCKETS = 8;
+
+// One bit per ball id
+typedef unsigned long long BallMask;
+static_assert(POOL_MAX_BALLS <= 64, "BallMask holds at most 64 balls");
+
+
+struct PocketSet
+{
+    int count = 0;
+    float x[POOL_MAX_POCKETS];
+    float z[POOL_MAX_POCKETS];
+    float radius[POOL_MAX_POCKETS];
+
+    void clear() { this->count = 0; }
+
+    // Same pockets in the same order; slots past count don't matter
+    bool operator==(const PocketSet& other) const
+    {
+        if (this->count != other.count)
+            return false;
+        for (int p = 0; p < this->count; p++)
+        {
+            if (this->x[p] != other.x[p] || this->z[p] != other.z[p] || this->radius[p] != other.radius[p])
+                return false;
+        }
+        return true;
+    }
+
+    bool add(float x, float z, float radius)
+    {
+        if (this->count >= POOL_MAX_POCKETS)
+            return false;
+        this->x[this->count] = x;
+        this->z[this->count] = z;
+        this->radius[this->count] = radius;
+        this->count++;
+        return true;
+    }
+
+    // Four corners plus the middle of each side cushion
+    static PocketSet sixPocket(float left, float right, float back, float front, float cornerRadius, float sideRadius)
+    {
+        PocketSet p;
+        p.add(right, back, cornerRadius);
+        p.add(left, back, cornerRadius);
+        p.add(right, 0.5f * (back + front), sideRadius);
+        p.add(left, 0.5f * (back + front), sideRadius);
+        p.add(right, front, cornerRadius);
+        p.add(left, front, cornerRadius);
+        return p;
+    }
+
+    // Balls on the table whose centre is inside a pocket
+    BallMask capture(const BallTable& b) const
+    {
+        // Whole blocks of 8 so the inner loop vectorizes; slots past count
+        // are zeroed by BallTable and masked off below
+        const int n = (b.count + 7) & ~7;
+        unsigned char inside[POOL_MAX_BALLS];
+
+        for (int i = 0; i < n; i++)
+            inside[i] = 0;
+
+        for (int p = 0; p < this->count; p++)
+        {
+            const float px = this->x[p], pz = this->z[p];
+            const float r2 = this->radius[p] * this->radius[p];
+            for (int i = 0; i < n; i++)
+            {
+                float dx = b.x[i] - px;
+                float dz = b.z[i] - pz;
+                inside[i] |= (unsigned char)(dx * dx + dz * dz < r2);
+            }
+        }
+
+        BallMask mask = 0;
+        for (int i = 0; i < b.count; i++)
+            mask |= (BallMask)(inside[i] & !(b.flags[i] & BALL_POCKETED)) << i;
+        return mask;
+    }
+};
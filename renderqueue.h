@@ -0,0 +1,310 @@
+#pragma once
+//==============================================================================
+//                                Render Queue
+//==============================================================================
+//
+// Draws are submitted during the frame as commands and issued together by
+// flush(), sorted so that draws sharing a shader, then a texture, then a
+// vertex array run back to back. Each command has a 64 bit key:
+//
+//     63..56  shader slot, in the order addShader() was called
+//     55..40  texture
+//     39..24  vertex array
+//     23..0   distance from the camera, nearest first
+//
+// The keys are radix sorted, 8 bits a pass, skipping any byte every key
+// shares. flush() then only calls glUseProgram, glBindTexture and
+// glBindVertexArray when the value changes, and unbinds once at the end.
+// View, projection and lighting come from the frame's uniform block (see
+// frameuniforms.h); any other uniform a shader needs must be set on it
+// before flush().
+//
+// The model matrix is a vertex attribute at locations 3 to 6. Meshes in the
+// GeometryArena given to useArena() all share its VAO, so a run of them with
+// the same shader and texture is drawn together by the arena (one
+// glMultiDrawElementsIndirect where supported). Other meshes are drawn from
+// their own VAO with the matrix set as a constant attribute, or from their
+// instance buffer when instanced.
+//
+// Commands are indexed triangles drawn with texture unit 0 bound, or with
+// nothing bound when their texture is 0; the models here carry at most one
+// diffuse texture per mesh. The arrays are sized up front, so a frame
+// allocates nothing. Past RENDER_QUEUE_MAX commands in a frame, draws are
+// dropped.
+//
+//==============================================================================
+#include <iostream>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "shader.h"
+#include "model.h"
+#include "geometryarena.h"
+
+const int RENDER_QUEUE_MAX = 1024;
+const int RENDER_QUEUE_SHADERS = 16;
+
+// Distance the depth bits span; matches the projection's far plane
+const float RENDER_QUEUE_FAR = 10000.0f;
+
+static_assert(RENDER_QUEUE_MAX <= GEOMETRY_ARENA_DRAWS, "A frame's arena draws must fit the arena's buffers");
+
+
+struct RenderCommand
+{
+    unsigned long long key;
+    const Shader* shader;
+    GLuint vao;
+    GLsizei count;              // Indices
+    GLuint firstIndex;          // Where they start in the VAO's index buffer
+    GLint baseVertex;
+    GLsizei instances;          // Drawn instanced when more than 1
+    GLenum textureTarget;       // GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY
+    GLuint texture;             // 0 for none
+    glm::mat4 model;
+};
+
+// What the last flush() cost
+struct RenderQueueStats
+{
+    unsigned draws = 0;
+    unsigned calls = 0;         // glDraw* calls they took
+    unsigned programs = 0;      // glUseProgram calls
+    unsigned textures = 0;      // glBindTexture calls, not counting the unbind at the end
+    unsigned arrays = 0;        // glBindVertexArray calls, likewise
+};
+
+
+class RenderQueue
+{
+public:
+    RenderQueue() : commands(RENDER_QUEUE_MAX), sorted(RENDER_QUEUE_MAX), scratch(RENDER_QUEUE_MAX),
+        arenaCommands(RENDER_QUEUE_MAX), arenaModels(RENDER_QUEUE_MAX) {}
+
+    // Meshes with the arena's VAO are drawn through it from then on
+    void useArena(GeometryArena* arena) { this->arena = arena; }
+
+    // Returns the slot to submit with; shaders added first draw first
+    int addShader(const Shader& shader)
+    {
+        if (this->shaderCount >= RENDER_QUEUE_SHADERS)
+        {
+            std::cout << "ERROR::RENDERQUEUE::TOO_MANY_SHADERS" << std::endl;
+            return RENDER_QUEUE_SHADERS - 1;
+        }
+        this->shaders[this->shaderCount] = &shader;
+        return this->shaderCount++;
+    }
+
+    // Start a frame seen through `view`, which orders draws by depth
+    void begin(const glm::mat4& view)
+    {
+        this->view = view;
+        this->count = 0;
+    }
+
+    void submit(int shader, GLuint vao, GLsizei indices, GLenum textureTarget, GLuint texture,
+        const glm::mat4& model, float depth, GLsizei instances = 1, GLuint firstIndex = 0, GLint baseVertex = 0)
+    {
+        if (this->count >= RENDER_QUEUE_MAX)
+        {
+            if (!this->overflowed)
+                std::cout << "ERROR::RENDERQUEUE::FULL " << RENDER_QUEUE_MAX << " commands" << std::endl;
+            this->overflowed = true;
+            return;
+        }
+
+        float d = depth / RENDER_QUEUE_FAR;
+        d = d < 0.0f ? 0.0f : (d > 1.0f ? 1.0f : d);
+        RenderCommand& c = this->commands[this->count++];
+        c.key = ((unsigned long long)(shader & 0xFF) << 56)
+            | ((unsigned long long)(texture & 0xFFFF) << 40)
+            | ((unsigned long long)(vao & 0xFFFF) << 24)
+            | (unsigned long long)(d * 0xFFFFFF);
+        c.shader = this->shaders[shader];
+        c.vao = vao;
+        c.count = indices;
+        c.firstIndex = firstIndex;
+        c.baseVertex = baseVertex;
+        c.instances = instances;
+        c.textureTarget = textureTarget;
+        c.texture = texture;
+        c.model = model;
+    }
+
+    // Every mesh of a model, at the distance of the model's origin
+    void submit(int shader, const Model& model, const glm::mat4& transform)
+    {
+        const float depth = -(this->view * transform[3]).z;
+        for (const Mesh& mesh : model.meshes)
+        {
+            GLuint texture = mesh.textures.empty() ? 0 : mesh.textures[0].id;
+            this->submit(shader, mesh.VAO, (GLsizei)mesh.indices.size(), GL_TEXTURE_2D, texture, transform, depth,
+                1, mesh.firstIndex, mesh.baseVertex);
+        }
+    }
+
+    // Sort and draw everything submitted since begin()
+    void flush()
+    {
+        this->sort();
+        this->last = RenderQueueStats();
+
+        // The arena's draws go up together, in the order they will be drawn
+        const GLuint arenaVAO = this->arena ? this->arena->VAO : 0;
+        if (this->arena)
+        {
+            int n = 0;
+            for (int i = 0; i < this->count; i++)
+            {
+                const RenderCommand& c = this->commands[this->ordered[i].index];
+                if (c.vao != arenaVAO)
+                    continue;
+                DrawElementsIndirectCommand& d = this->arenaCommands[n];
+                d.count = (GLuint)c.count;
+                d.instanceCount = 1;
+                d.firstIndex = c.firstIndex;
+                d.baseVertex = c.baseVertex;
+                d.baseInstance = (GLuint)n;
+                this->arenaModels[n++] = c.model;
+            }
+            this->arena->upload(this->arenaCommands.data(), this->arenaModels.data(), n);
+        }
+
+        const Shader* shader = nullptr;
+        GLuint vao = 0, bound2D = 0, boundArray = 0;
+        int arenaNext = 0;
+        glActiveTexture(GL_TEXTURE0);
+        for (int i = 0; i < this->count;)
+        {
+            const RenderCommand& c = this->commands[this->ordered[i].index];
+            if (c.shader != shader)
+            {
+                shader = c.shader;
+                shader->Use();
+                this->last.programs++;
+            }
+
+            // Untextured draws unbind, as Mesh::Draw leaves them; they sort
+            // first within a shader, so that is one bind at most
+            GLuint& bound = c.textureTarget == GL_TEXTURE_2D_ARRAY ? boundArray : bound2D;
+            if (c.texture != bound)
+            {
+                glBindTexture(c.textureTarget, c.texture);
+                bound = c.texture;
+                this->last.textures++;
+            }
+            if (c.vao != vao)
+            {
+                glBindVertexArray(c.vao);
+                vao = c.vao;
+                this->last.arrays++;
+            }
+
+            // Every following arena draw with this shader and texture at once
+            if (this->arena && c.vao == arenaVAO)
+            {
+                int run = 1;
+                while (i + run < this->count)
+                {
+                    const RenderCommand& next = this->commands[this->ordered[i + run].index];
+                    if (next.shader != c.shader || next.vao != c.vao || next.texture != c.texture || next.textureTarget != c.textureTarget)
+                        break;
+                    run++;
+                }
+                this->last.calls += this->arena->draw(arenaNext, run);
+                this->last.draws += run;
+                arenaNext += run;
+                i += run;
+                continue;
+            }
+
+            if (c.instances > 1)
+                glDrawElementsInstanced(GL_TRIANGLES, c.count, GL_UNSIGNED_INT, (const GLvoid*)(c.firstIndex * sizeof(GLuint)), c.instances);
+            else
+            {
+                for (GLuint k = 0; k < 4; k++)
+                    glVertexAttrib4fv(GEOMETRY_ARENA_MODEL + k, &c.model[k][0]);
+                glDrawElementsBaseVertex(GL_TRIANGLES, c.count, GL_UNSIGNED_INT, (const GLvoid*)(c.firstIndex * sizeof(GLuint)), c.baseVertex);
+            }
+            this->last.calls++;
+            this->last.draws++;
+            i++;
+        }
+
+        glBindVertexArray(0);
+        if (this->arena)
+            this->arena->finish();
+        if (bound2D)
+            glBindTexture(GL_TEXTURE_2D, 0);
+        if (boundArray)
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        this->count = 0;
+    }
+
+    const RenderQueueStats& stats() const { return this->last; }
+
+private:
+    struct SortEntry
+    {
+        unsigned long long key;
+        int index;
+    };
+
+    const Shader* shaders[RENDER_QUEUE_SHADERS];
+    int shaderCount = 0;
+
+    glm::mat4 view;
+
+    std::vector<RenderCommand> commands;
+    std::vector<SortEntry> sorted;
+    std::vector<SortEntry> scratch;
+    const SortEntry* ordered = nullptr;
+    int count = 0;
+    bool overflowed = false;
+
+    RenderQueueStats last;
+
+    GeometryArena* arena = nullptr;
+    std::vector<DrawElementsIndirectCommand> arenaCommands;
+    std::vector<glm::mat4> arenaModels;
+
+    // Least significant byte first; each pass is stable, so ties keep their
+    // submission order
+    void sort()
+    {
+        SortEntry* from = this->sorted.data();
+        SortEntry* to = this->scratch.data();
+        for (int i = 0; i < this->count; i++)
+        {
+            from[i].key = this->commands[i].key;
+            from[i].index = i;
+        }
+
+        for (int shift = 0; shift < 64 && this->count > 1; shift += 8)
+        {
+            int buckets[256] = {};
+            for (int i = 0; i < this->count; i++)
+                buckets[(from[i].key >> shift) & 0xFF]++;
+            if (buckets[(from[0].key >> shift) & 0xFF] == this->count)
+                continue;
+
+            int offset = 0;
+            for (int b = 0; b < 256; b++)
+            {
+                int n = buckets[b];
+                buckets[b] = offset;
+                offset += n;
+            }
+            for (int i = 0; i < this->count; i++)
+                to[buckets[(from[i].key >> shift) & 0xFF]++] = from[i];
+
+            SortEntry* swap = from;
+            from = to;
+            to = swap;
+        }
+        this->ordered = from;
+    }
+};
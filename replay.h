@@ -0,0 +1,312 @@
+#pragma once
+//==============================================================================
+//                                Replay
+//==============================================================================
+//
+// Record a play session and run it back exactly.
+//
+// The simulation only ever changes through fixed steps and player inputs, so a
+// session is fully described by the starting table plus each input tagged with
+// the step it arrived before. The recorder also stores a hash of the table
+// after every step; the replayer recomputes it and reports the first step
+// where the two disagree.
+//
+// File layout (little endian, as written by the x86/x64 builds):
+//     "POOLREC1", sizes of SimConfig and BallTable
+//     starting SimConfig, BallTable, cue position, cue hit flag, solver
+//     records until end of file:
+//         REC_INPUT: type, step, seconds since start, value
+//         REC_HASH:  type, step, 32 bit hash
+//
+//==============================================================================
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#include "simulation.h"
+
+static_assert(std::is_trivially_copyable<SimConfig>::value, "SimConfig is written as raw bytes");
+static_assert(std::is_trivially_copyable<BallTable>::value, "BallTable is written as raw bytes");
+
+// Player actions that change the physics
+enum InputType
+{
+    INPUT_MOVE_CUE = 1,     // value is the distance moved
+    INPUT_RESET = 2
+};
+
+enum RecordType
+{
+    REC_INPUT = 1,
+    REC_HASH = 2
+};
+
+const char REPLAY_MAGIC[8] = { 'P', 'O', 'O', 'L', 'R', 'E', 'C', '1' };
+
+
+// Hash of the table after a step, see tableHash()
+inline unsigned stateHash(const Simulation& sim)
+{
+    return tableHash(sim.balls, sim.cueZ, sim.cueHit);
+}
+
+// Apply one recorded or live input to the table
+inline void applyInput(Simulation& sim, int type, float value)
+{
+    if (type == INPUT_MOVE_CUE)
+        sim.moveCue(value);
+    else if (type == INPUT_RESET)
+        sim.reset();
+}
+
+
+class SessionRecorder : public StepObserver
+{
+public:
+    ~SessionRecorder() { this->end(); }
+
+    // Start a new file from the table as it is now
+    bool begin(const char* path, const Simulation& sim)
+    {
+        this->file.open(path, std::ios::binary | std::ios::trunc);
+        if (!this->file)
+        {
+            std::cout << "ERROR::REPLAY::CANNOT_WRITE " << path << std::endl;
+            return false;
+        }
+
+        this->startStep = sim.stepCount;
+        this->buffer.clear();
+        this->put(REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+        this->putValue((unsigned)sizeof(SimConfig));
+        this->putValue((unsigned)sizeof(BallTable));
+        this->put(&sim.config, sizeof(SimConfig));
+        this->put(&sim.balls, sizeof(BallTable));
+        this->putValue(sim.cueZ);
+        this->putValue((unsigned char)(sim.cueHit ? 1 : 0));
+        this->putValue((unsigned char)sim.solver);
+        return true;
+    }
+
+    // Log a player input and apply it. `seconds` is wall time since start.
+    void input(Simulation& sim, int type, float value, float seconds)
+    {
+        if (this->file.is_open())
+        {
+            this->putValue((unsigned char)REC_INPUT);
+            this->putValue((unsigned)(sim.stepCount - this->startStep));
+            this->putValue((unsigned char)type);
+            this->putValue(seconds);
+            this->putValue(value);
+        }
+        applyInput(sim, type, value);
+    }
+
+    void stepped(Simulation& sim, unsigned) override
+    {
+        if (!this->file.is_open())
+            return;
+
+        this->putValue((unsigned char)REC_HASH);
+        this->putValue((unsigned)(sim.stepCount - this->startStep));
+        this->putValue(stateHash(sim));
+
+        if (this->buffer.size() >= 64 * 1024)
+            this->flush();
+    }
+
+    void end()
+    {
+        if (!this->file.is_open())
+            return;
+        this->flush();
+        this->file.close();
+    }
+
+private:
+    std::ofstream file;
+    std::vector<char> buffer;
+    unsigned long long startStep = 0;
+
+    void put(const void* data, size_t size)
+    {
+        const char* p = (const char*)data;
+        this->buffer.insert(this->buffer.end(), p, p + size);
+    }
+
+    template <typename T> void putValue(T value) { this->put(&value, sizeof(T)); }
+
+    void flush()
+    {
+        this->file.write(this->buffer.data(), (std::streamsize)this->buffer.size());
+        this->buffer.clear();
+    }
+};
+
+
+struct RecordedInput
+{
+    unsigned step;
+    int type;
+    float seconds;
+    float value;
+};
+
+class SessionReplayer : public StepObserver
+{
+public:
+    std::vector<RecordedInput> inputs;
+    std::vector<unsigned> hashes;           // Expected hash after step i + 1
+
+    long long divergedAt = -1;              // First step whose hash didn't match
+
+    bool load(const char* path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            std::cout << "ERROR::REPLAY::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+            return false;
+        }
+        std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        this->data.swap(data);
+        this->pos = 0;
+
+        char magic[sizeof(REPLAY_MAGIC)];
+        unsigned configSize = 0, tableSize = 0;
+        unsigned char cueHit = 0, solver = 0;
+        bool ok = this->get(magic, sizeof(magic)) && memcmp(magic, REPLAY_MAGIC, sizeof(magic)) == 0
+            && this->getValue(configSize) && configSize == sizeof(SimConfig)
+            && this->getValue(tableSize) && tableSize == sizeof(BallTable)
+            && this->get(&this->config, sizeof(SimConfig))
+            && this->get(&this->table, sizeof(BallTable))
+            && this->getValue(this->cueZ) && this->getValue(cueHit) && this->getValue(solver);
+        if (!ok)
+        {
+            std::cout << "ERROR::REPLAY::BAD_HEADER " << path << std::endl;
+            return false;
+        }
+        this->cueHit = cueHit != 0;
+        this->solver = (SimSolver)solver;
+
+        this->inputs.clear();
+        this->hashes.clear();
+        while (this->pos < this->data.size())
+        {
+            unsigned char type = 0;
+            unsigned step = 0;
+            if (!this->getValue(type) || !this->getValue(step))
+                break;
+
+            if (type == REC_INPUT)
+            {
+                RecordedInput in;
+                unsigned char inputType = 0;
+                in.step = step;
+                if (!this->getValue(inputType) || !this->getValue(in.seconds) || !this->getValue(in.value))
+                    break;
+                in.type = inputType;
+                this->inputs.push_back(in);
+            }
+            else if (type == REC_HASH)
+            {
+                unsigned hash = 0;
+                if (!this->getValue(hash))
+                    break;
+                if (step == 0)
+                    continue;
+                if (step > this->hashes.size())
+                    this->hashes.resize(step);
+                this->hashes[step - 1] = hash;
+            }
+            else
+            {
+                std::cout << "ERROR::REPLAY::BAD_RECORD at byte " << this->pos << std::endl;
+                return false;
+            }
+        }
+        this->data.clear();
+        return true;
+    }
+
+    // Put the recorded starting table into sim and start watching its steps
+    void start(Simulation& sim)
+    {
+        sim.config = this->config;
+        sim.balls = this->table;
+        sim.cueZ = this->cueZ;
+        sim.cueHit = this->cueHit;
+        sim.solver = this->solver;
+        sim.accumulator = 0.0;
+        sim.eventSolver.invalidate();
+        sim.observer = this;
+
+        this->startStep = sim.stepCount;
+        this->nextInput = 0;
+        this->divergedAt = -1;
+        this->applyDue(sim);
+    }
+
+    unsigned long long stepsDone(const Simulation& sim) const { return sim.stepCount - this->startStep; }
+    bool finished(const Simulation& sim) const { return this->stepsDone(sim) >= this->hashes.size(); }
+
+    // Run the whole session as fast as possible. Returns true if every step
+    // matched the recording.
+    bool runHeadless(Simulation& sim, bool stopOnDivergence = true)
+    {
+        this->start(sim);
+        while (!this->finished(sim))
+        {
+            sim.step();
+            if (stopOnDivergence && this->divergedAt >= 0)
+                break;
+        }
+        return this->divergedAt < 0;
+    }
+
+    void stepped(Simulation& sim, unsigned) override
+    {
+        unsigned long long done = this->stepsDone(sim);
+        if (done <= this->hashes.size() && this->divergedAt < 0 && stateHash(sim) != this->hashes[done - 1])
+            this->divergedAt = (long long)done;
+        this->applyDue(sim);
+    }
+
+private:
+    SimConfig config;
+    BallTable table;
+    float cueZ = 0.0f;
+    bool cueHit = false;
+    SimSolver solver = SIM_SOLVER_STEP;
+
+    unsigned long long startStep = 0;
+    size_t nextInput = 0;
+
+    std::vector<char> data;
+    size_t pos = 0;
+
+    // Inputs that arrived before the next step
+    void applyDue(Simulation& sim)
+    {
+        unsigned long long done = this->stepsDone(sim);
+        while (this->nextInput < this->inputs.size() && this->inputs[this->nextInput].step <= done)
+        {
+            const RecordedInput& in = this->inputs[this->nextInput++];
+            applyInput(sim, in.type, in.value);
+        }
+    }
+
+    bool get(void* out, size_t size)
+    {
+        if (this->pos + size > this->data.size())
+            return false;
+        memcpy(out, &this->data[this->pos], size);
+        this->pos += size;
+        return true;
+    }
+
+    template <typename T> bool getValue(T& out) { return this->get(&out, sizeof(T)); }
+};
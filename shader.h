@@ -4,16 +4,27 @@
 
 #include <GL/glew.h>
 
+#include <cstring>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+
+// Most textures of one kind a mesh binds (texture_diffuse1 to texture_diffuseN)
+const int SHADER_MAX_SAMPLERS = 4;
 
 class Shader
 {
 public:
     GLuint Program;
 
+    // Uniform locations, looked up once when the program is linked. -1 where
+    // the program doesn't use one, which glUniform* quietly ignores.
+    GLint ModelLoc, ViewLoc, ProjectionLoc;
+    GLint DiffuseLoc[SHADER_MAX_SAMPLERS];      // texture_diffuse1...
+    GLint SpecularLoc[SHADER_MAX_SAMPLERS];     // texture_specular1...
+
     // Constructor generates the shader on the fly
     Shader(const GLchar* vertexPath, const GLchar* fragmentPath, const GLchar* geometryPath = nullptr)
     {
@@ -90,6 +101,7 @@ public:
             glAttachShader(this->Program, geometry);
         glLinkProgram(this->Program);
         checkCompileErrors(this->Program, "PROGRAM");
+        this->cacheUniforms();
 
         // Delete the shaders as they're linked into our program now and no longer necessery
         glDeleteShader(vertex);
@@ -100,9 +112,58 @@ public:
     }
 
     // Uses the current shader
-    void Use() { glUseProgram(this->Program); }
+    void Use() const { glUseProgram(this->Program); }
+
+    // Location of any active uniform, from the table made at link time rather
+    // than asking the driver. Resolve it once outside the render loop anyway.
+    GLint Uniform(const GLchar* name) const
+    {
+        for (const ActiveUniform& u : this->uniforms)
+        {
+            if (strcmp(u.name.c_str(), name) == 0)
+                return u.location;
+        }
+        return -1;
+    }
 
 private:
+    struct ActiveUniform
+    {
+        std::string name;       // Arrays by their first element's name, without [0]
+        GLint location;
+    };
+    std::vector<ActiveUniform> uniforms;
+
+    void cacheUniforms()
+    {
+        GLint count = 0, longest = 0;
+        glGetProgramiv(this->Program, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(this->Program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &longest);
+        std::vector<GLchar> name(longest > 0 ? longest : 1);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLint size;
+            GLenum type;
+            glGetActiveUniform(this->Program, (GLuint)i, (GLsizei)name.size(), NULL, &size, &type, name.data());
+
+            ActiveUniform u;
+            u.name = name.data();
+            u.location = glGetUniformLocation(this->Program, name.data());
+            if (u.name.size() > 3 && u.name.compare(u.name.size() - 3, 3, "[0]") == 0)
+                u.name.resize(u.name.size() - 3);
+            this->uniforms.push_back(u);
+        }
+
+        this->ModelLoc = this->Uniform("model");
+        this->ViewLoc = this->Uniform("view");
+        this->ProjectionLoc = this->Uniform("projection");
+        for (int n = 0; n < SHADER_MAX_SAMPLERS; n++)
+        {
+            this->DiffuseLoc[n] = this->Uniform(("texture_diffuse" + std::to_string(n + 1)).c_str());
+            this->SpecularLoc[n] = this->Uniform(("texture_specular" + std::to_string(n + 1)).c_str());
+        }
+    }
+
     void checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
@@ -0,0 +1,217 @@
+#pragma once
+//==============================================================================
+//                                Shot Batch
+//==============================================================================
+//
+// Monte-Carlo evaluation of a shot. The same table is played over and over
+// with the cue speed and angle drawn from a normal distribution, and the
+// outcomes are totalled: how often each ball drops, and a histogram of where
+// each ball comes to rest. Every run goes through Simulation, so the cushion,
+// ball and pocket rules are the ones the player sees in the game.
+//
+// Shots are split across a ThreadPool. Every worker keeps its own Simulation,
+// random stream and running totals, and the totals are merged at the end. The
+// random stream is reseeded from the shot index at the start of each chunk,
+// so results are the same whichever worker happens to run a chunk.
+//
+// With an EventLog in the settings every worker also logs its collisions
+// through an EventLogWriter of its own, each record stamped with the index
+// of the shot it came from.
+//
+//==============================================================================
+#include <cmath>
+#include <vector>
+
+#include "eventlog.h"
+#include "simulation.h"
+#include "threadpool.h"
+
+// Resting position histogram: cells of BATCH_HIST_CELL table units
+const int BATCH_HIST_COLS = 10;
+const int BATCH_HIST_ROWS = 24;
+const float BATCH_HIST_CELL = 10.0f;
+
+
+// Small counter-seeded generator (splitmix64). Same sequence on every
+// compiler, unlike the std:: distributions.
+struct ShotRng
+{
+    unsigned long long state;
+
+    explicit ShotRng(unsigned long long seed = 0) : state(seed) {}
+
+    unsigned long long next()
+    {
+        unsigned long long z = (this->state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in (0, 1]
+    double uniform() { return ((this->next() >> 11) + 1) * (1.0 / 9007199254740992.0); }
+
+    // Standard normal (Box-Muller)
+    double normal()
+    {
+        double u1 = this->uniform();
+        double u2 = this->uniform();
+        return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+    }
+};
+
+
+// Cue speed (units per second) and direction. Angle 0 sends the cue ball
+// straight down the table (-z); positive angles turn towards +x. Spin is the
+// ball's spin as a share of its speed: 1 rolls naturally, 0 is a stun shot
+// and negative is draw. It only matters on tables with cloth friction.
+struct ShotParams
+{
+    float speed;
+    float angle;    // Radians
+    float spin;
+};
+
+struct ShotDistribution
+{
+    ShotParams mean;
+    ShotParams sigma;
+};
+
+// Start the cue ball moving with the given shot, in place of the cue strike
+inline void applyShot(Simulation& sim, const ShotParams& shot)
+{
+    BallTable& b = sim.balls;
+    b.vx[CUE_BALL] = shot.speed * std::sin(shot.angle);
+    b.vz[CUE_BALL] = -shot.speed * std::cos(shot.angle);
+    b.rx[CUE_BALL] = shot.spin * b.vx[CUE_BALL];
+    b.rz[CUE_BALL] = shot.spin * b.vz[CUE_BALL];
+    b.flags[CUE_BALL] |= BALL_MOVING;
+    sim.cueHit = true;
+    sim.eventSolver.invalidate();
+}
+
+
+struct BatchOutcome
+{
+    unsigned long long shots = 0;
+    int balls = 0;
+    unsigned long long pocketed[POOL_MAX_BALLS] = {};
+    std::vector<unsigned> restHistogram;    // [ball][row][col], pocketed balls not counted
+    SubstepStats substeps;                  // Fixed stepper only
+
+    void init(int ballCount)
+    {
+        this->balls = ballCount;
+        this->restHistogram.assign((size_t)ballCount * BATCH_HIST_ROWS * BATCH_HIST_COLS, 0);
+    }
+
+    double pocketProbability(int ball) const
+    {
+        return this->shots ? (double)this->pocketed[ball] / (double)this->shots : 0.0;
+    }
+
+    unsigned restCount(int ball, int row, int col) const
+    {
+        return this->restHistogram[((size_t)ball * BATCH_HIST_ROWS + row) * BATCH_HIST_COLS + col];
+    }
+
+    // Tally the final state of one run
+    void record(const BallTable& b, const SimConfig& c)
+    {
+        this->shots++;
+        for (int i = 0; i < b.count; i++)
+        {
+            if (b.pocketed(i))
+            {
+                this->pocketed[i]++;
+                continue;
+            }
+
+            int col = (int)((b.x[i] - c.tableleft) / BATCH_HIST_CELL);
+            int row = (int)((b.z[i] - c.tableback) / BATCH_HIST_CELL);
+            col = col < 0 ? 0 : (col >= BATCH_HIST_COLS ? BATCH_HIST_COLS - 1 : col);
+            row = row < 0 ? 0 : (row >= BATCH_HIST_ROWS ? BATCH_HIST_ROWS - 1 : row);
+            this->restHistogram[((size_t)i * BATCH_HIST_ROWS + row) * BATCH_HIST_COLS + col]++;
+        }
+    }
+
+    void merge(const BatchOutcome& other)
+    {
+        this->shots += other.shots;
+        this->substeps.merge(other.substeps);
+        for (int i = 0; i < this->balls; i++)
+            this->pocketed[i] += other.pocketed[i];
+        for (size_t i = 0; i < this->restHistogram.size(); i++)
+            this->restHistogram[i] += other.restHistogram[i];
+    }
+};
+
+
+struct BatchSettings
+{
+    unsigned long long shots = 100000;
+    double duration = 20.0;         // Simulated seconds per shot
+    unsigned long long seed = 1;
+    size_t grain = 1024;            // Shots per chunk handed to a worker
+    EventLog* log = nullptr;        // Where to log every collision, if anywhere
+};
+
+
+// Play `settings.shots` variations of the shot from `table` and total the results
+inline BatchOutcome runShotBatch(ThreadPool& pool, const Simulation& table,
+    const ShotDistribution& dist, const BatchSettings& settings)
+{
+    const unsigned workers = pool.size();
+    std::vector<BatchOutcome> partial(workers);
+    std::vector<Simulation> sims(workers, table);
+    std::vector<std::unique_ptr<EventLogWriter>> writers(workers);
+    for (unsigned w = 0; w < workers; w++)
+    {
+        partial[w].init(table.balls.count);
+        sims[w].observer = nullptr;
+        sims[w].collisions.queue = nullptr;
+        sims[w].collisions.listener = nullptr;
+        sims[w].substepStats = SubstepStats();
+        if (settings.log)
+        {
+            writers[w].reset(new EventLogWriter(*settings.log));
+            sims[w].collisions.listener = writers[w].get();
+        }
+    }
+
+    pool.parallelFor((size_t)settings.shots, settings.grain,
+        [&](size_t begin, size_t end, unsigned worker)
+        {
+            Simulation& sim = sims[worker];
+            BatchOutcome& out = partial[worker];
+            ShotRng rng(settings.seed ^ (0xD1B54A32D192ED03ull * (begin + 1)));
+
+            for (size_t i = begin; i < end; i++)
+            {
+                ShotParams shot;
+                shot.speed = (float)(dist.mean.speed + dist.sigma.speed * rng.normal());
+                shot.angle = (float)(dist.mean.angle + dist.sigma.angle * rng.normal());
+                shot.spin = dist.mean.spin;
+
+                sim.balls = table.balls;
+                sim.stepCount = 0;
+                if (writers[worker])
+                    writers[worker]->run = (unsigned)i;
+                applyShot(sim, shot);
+                sim.simulate(settings.duration);
+                out.record(sim.balls, sim.config);
+            }
+        });
+
+    // Their last blocks go to the log before the caller can close it
+    writers.clear();
+    for (unsigned w = 0; w < workers; w++)
+        partial[w].substeps = sims[w].substepStats;
+
+    BatchOutcome total;
+    total.init(table.balls.count);
+    for (unsigned w = 0; w < workers; w++)
+        total.merge(partial[w]);
+    return total;
+}
@@ -0,0 +1,359 @@
+#pragma once
+//==============================================================================
+//                                Shot Planner
+//==============================================================================
+//
+// Brute force search for the best shot from the table as it stands, for a
+// computer opponent or a hint. Every combination on a grid of cue angle,
+// speed and spin is played through Simulation, in parallel, and the best
+// few are kept.
+//
+// A candidate is abandoned as soon as it is certain to be useless: the cue
+// ball drops (a scratch), or the first ball it touches isn't the target (a
+// miss). Contacts are taken from the simulation's collision records, since
+// under the keep-factor rules a struck ball at rest has no speed to move
+// off with and may not visibly move. Otherwise a candidate runs until the
+// table comes to rest or time runs out, and is scored on what it potted and
+// how close it left the target to a pocket.
+//
+// Each worker plays its candidates on its own Simulation, restored from a
+// snapshot of the table for every one, and keeps its own top list in a
+// fixed array, so once a worker has played its first candidate nothing more
+// is allocated. Ties go to the lower grid index, so the result doesn't
+// depend on which worker ran what.
+//
+// The table should be at rest when planning; balls already moving play out
+// alongside the shot.
+//
+//==============================================================================
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "simulation.h"
+#include "shotbatch.h"
+#include "threadpool.h"
+
+// Longest top list plan() can return
+const int PLANNER_MAX_TOP = 16;
+
+// Score for each ball potted, and extra for the target
+const float PLANNER_POT_SCORE = 100.0f;
+const float PLANNER_TARGET_SCORE = 1000.0f;
+
+// Most score for leaving the target next to a pocket, falling to nothing a
+// table length away
+const float PLANNER_POSITION_SCORE = 10.0f;
+
+
+struct PlannerSettings
+{
+    int angles = 180;           // Spread evenly around the full circle
+    int speeds = 6;
+    int spins = 3;              // Collapsed to one stun shot without cloth friction
+    float minSpeed = 60.0f;     // Units per second
+    float maxSpeed = 400.0f;
+    float minSpin = -1.0f;
+    float maxSpin = 1.0f;
+
+    int target = -1;            // Ball to pot, or -1 for any object ball
+    int top = 5;                // Shots to return, at most PLANNER_MAX_TOP
+    double duration = 8.0;      // Simulated seconds before giving up on a candidate
+    size_t grain = 16;          // Candidates per chunk handed to a worker
+};
+
+struct PlannedShot
+{
+    ShotParams shot;
+    float score;
+    BallMask pocketed;
+    unsigned index;             // Position on the grid
+};
+
+struct PlannerResult
+{
+    PlannedShot shots[PLANNER_MAX_TOP];
+    int count = 0;
+
+    unsigned long long candidates = 0;
+    unsigned long long scratches = 0;
+    unsigned long long misses = 0;
+    unsigned long long steps = 0;
+    double seconds = 0.0;
+};
+
+
+// Best first, fixed capacity
+struct ShotShortlist
+{
+    PlannedShot shots[PLANNER_MAX_TOP];
+    int count = 0;
+    int capacity = PLANNER_MAX_TOP;
+
+    static bool better(const PlannedShot& a, const PlannedShot& b)
+    {
+        return a.score > b.score || (a.score == b.score && a.index < b.index);
+    }
+
+    void offer(const PlannedShot& shot)
+    {
+        if (this->count == this->capacity && !better(shot, this->shots[this->count - 1]))
+            return;
+
+        int i = this->count < this->capacity ? this->count++ : this->count - 1;
+        for (; i > 0 && better(shot, this->shots[i - 1]); i--)
+            this->shots[i] = this->shots[i - 1];
+        this->shots[i] = shot;
+    }
+};
+
+
+class ShotPlanner
+{
+public:
+    explicit ShotPlanner(ThreadPool& pool) : pool(pool) {}
+
+    // Search from the table as it is in `table`, which is left untouched
+    PlannerResult plan(const Simulation& table, const PlannerSettings& settings)
+    {
+        auto started = std::chrono::steady_clock::now();
+        const unsigned workers = this->pool.size();
+
+        // The planner's scratch space is kept between calls and only allocated
+        // by the first plan (the pool still allocates to deal out the work).
+        // The simulations aren't copied from the table; every candidate
+        // restores it from a snapshot.
+        if (this->sims.size() != workers)
+            this->sims.resize(workers);
+        this->lists.assign(workers, ShotShortlist());
+        this->tallies.assign(workers, Tally());
+        this->contacts.assign(workers, FirstContact());
+        for (unsigned w = 0; w < workers; w++)
+        {
+            this->sims[w].contacts = table.contacts;
+            this->sims[w].observer = nullptr;
+            this->sims[w].collisions.queue = nullptr;
+            this->sims[w].collisions.listener = &this->contacts[w];
+            this->lists[w].capacity = clampTop(settings.top);
+        }
+
+        const bool friction = table.config.slideFriction > 0.0f || table.config.rollFriction > 0.0f;
+        Grid grid;
+        grid.angles = settings.angles > 0 ? settings.angles : 1;
+        grid.speeds = settings.speeds > 0 ? settings.speeds : 1;
+        grid.spins = friction && settings.spins > 0 ? settings.spins : 1;
+
+        TableSnapshot start;
+        table.save(start);
+        const Watch watch = watchBalls(table.balls, settings.target);
+        const unsigned maxSteps = (unsigned)(settings.duration / SIM_FIXED_DT);
+
+        this->pool.parallelFor(grid.size(), settings.grain,
+            [&](size_t begin, size_t end, unsigned worker)
+            {
+                Simulation& sim = this->sims[worker];
+                FirstContact& contact = this->contacts[worker];
+                ShotShortlist& list = this->lists[worker];
+                Tally& tally = this->tallies[worker];
+
+                // Counted here and added once, the tallies share cache lines
+                unsigned long long steps = 0;
+                for (size_t i = begin; i < end; i++)
+                {
+                    PlannedShot candidate;
+                    candidate.index = (unsigned)i;
+                    candidate.shot = grid.shot(i, settings, friction);
+
+                    sim.restore(start);
+                    int outcome = play(sim, contact, candidate, watch, maxSteps, steps);
+                    if (outcome == PLAY_SCRATCH)
+                        tally.scratches++;
+                    else if (outcome == PLAY_MISS)
+                        tally.misses++;
+                    else
+                    {
+                        candidate.score = score(sim, candidate, settings);
+                        list.offer(candidate);
+                    }
+                }
+                tally.steps += steps;
+            });
+
+        PlannerResult result;
+        ShotShortlist best;
+        best.capacity = clampTop(settings.top);
+        for (unsigned w = 0; w < workers; w++)
+        {
+            for (int k = 0; k < this->lists[w].count; k++)
+                best.offer(this->lists[w].shots[k]);
+            result.scratches += this->tallies[w].scratches;
+            result.misses += this->tallies[w].misses;
+            result.steps += this->tallies[w].steps;
+        }
+        for (int k = 0; k < best.count; k++)
+            result.shots[k] = best.shots[k];
+        result.count = best.count;
+        result.candidates = grid.size();
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return result;
+    }
+
+private:
+    enum PlayOutcome
+    {
+        PLAY_DONE,
+        PLAY_SCRATCH,
+        PLAY_MISS
+    };
+
+    struct Grid
+    {
+        int angles, speeds, spins;
+
+        size_t size() const { return (size_t)this->angles * this->speeds * this->spins; }
+
+        ShotParams shot(size_t i, const PlannerSettings& s, bool friction) const
+        {
+            int spin = (int)(i % this->spins);
+            int speed = (int)(i / this->spins % this->speeds);
+            int angle = (int)(i / this->spins / this->speeds);
+
+            ShotParams p;
+            p.angle = 6.2831853f * angle / this->angles;
+            p.speed = this->speeds > 1 ? s.minSpeed + (s.maxSpeed - s.minSpeed) * speed / (this->speeds - 1) : s.maxSpeed;
+            p.spin = !friction ? 0.0f
+                : this->spins > 1 ? s.minSpin + (s.maxSpin - s.minSpin) * spin / (this->spins - 1) : 0.0f;
+            return p;
+        }
+    };
+
+    // Which balls the cue ball may touch first
+    struct Watch
+    {
+        BallMask wanted;        // Balls that count as a hit
+        BallMask wrong;         // Balls that are a miss if hit first
+    };
+
+    // The first ball the cue ball touches, from the simulation's collision
+    // records
+    struct FirstContact : CollisionListener
+    {
+        int ball = -1;
+
+        void collided(const CollisionEvent& e) override
+        {
+            if (this->ball < 0 && e.type == SIM_EVENT_BALL_HIT && (e.a == CUE_BALL || e.b == CUE_BALL))
+                this->ball = e.a == CUE_BALL ? e.b : e.a;
+        }
+    };
+
+    struct Tally
+    {
+        unsigned long long scratches = 0;
+        unsigned long long misses = 0;
+        unsigned long long steps = 0;
+    };
+
+    ThreadPool& pool;
+    std::vector<Simulation> sims;
+    std::vector<ShotShortlist> lists;
+    std::vector<Tally> tallies;
+    std::vector<FirstContact> contacts;     // Listened to by sims, one each
+
+    static int clampTop(int top) { return top < 1 ? 1 : (top > PLANNER_MAX_TOP ? PLANNER_MAX_TOP : top); }
+
+    static Watch watchBalls(const BallTable& b, int target)
+    {
+        Watch w;
+        w.wanted = w.wrong = 0;
+        for (int i = CUE_BALL + 1; i < b.count; i++)
+        {
+            if (b.flags[i] & BALL_POCKETED)
+                continue;
+
+            if (target < 0 || i == target)
+                w.wanted |= (BallMask)1 << i;
+            else
+                w.wrong |= (BallMask)1 << i;
+        }
+
+        // With the target already potted there is nothing to miss
+        if (target >= 0 && !w.wanted)
+            w.wrong = 0;
+        return w;
+    }
+
+    static int play(Simulation& sim, FirstContact& contact, PlannedShot& candidate, const Watch& watch,
+        unsigned maxSteps, unsigned long long& steps)
+    {
+        applyShot(sim, candidate.shot);
+        const BallTable& b = sim.balls;
+        bool touched = watch.wanted == 0;
+        contact.ball = -1;
+
+        for (unsigned s = 0; s < maxSteps; s++)
+        {
+            sim.step();
+            steps++;
+
+            if (b.pocketed(CUE_BALL))
+                return PLAY_SCRATCH;
+
+            if (!touched && contact.ball >= 0)
+            {
+                const BallMask hit = (BallMask)1 << contact.ball;
+                if (watch.wrong & hit)
+                    return PLAY_MISS;
+                touched = (watch.wanted & hit) != 0;
+            }
+
+            if (sim.idle())
+                break;
+        }
+        if (!touched)
+            return PLAY_MISS;
+
+        candidate.pocketed = 0;
+        for (int i = 0; i < b.count; i++)
+        {
+            if (b.pocketed(i))
+                candidate.pocketed |= (BallMask)1 << i;
+        }
+        return PLAY_DONE;
+    }
+
+    // Pots first, then how near the target (or best placed ball) was left to
+    // a pocket, then softer shots over harder ones
+    static float score(const Simulation& sim, const PlannedShot& candidate, const PlannerSettings& settings)
+    {
+        const BallTable& b = sim.balls;
+        const SimConfig& c = sim.config;
+        float total = 0.0f;
+        for (int i = CUE_BALL + 1; i < b.count; i++)
+        {
+            if (candidate.pocketed & ((BallMask)1 << i))
+                total += i == settings.target ? PLANNER_TARGET_SCORE + PLANNER_POT_SCORE : PLANNER_POT_SCORE;
+        }
+
+        const float length = c.tablefront - c.tableback;
+        float position = 0.0f;
+        for (int i = CUE_BALL + 1; i < b.count; i++)
+        {
+            if (b.pocketed(i) || (settings.target >= 0 && i != settings.target))
+                continue;
+
+            float nearest = length;
+            for (int p = 0; p < c.pockets.count; p++)
+            {
+                float dx = b.x[i] - c.pockets.x[p];
+                float dz = b.z[i] - c.pockets.z[p];
+                float d = std::sqrt(dx * dx + dz * dz);
+                nearest = d < nearest ? d : nearest;
+            }
+            float placed = PLANNER_POSITION_SCORE * (1.0f - nearest / length);
+            position = placed > position ? placed : position;
+        }
+
+        return total + position - candidate.shot.speed / settings.maxSpeed;
+    }
+};
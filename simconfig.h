@@ -0,0 +1,111 @@
+#pragma once
+//==============================================================================
+//                                Sim Config
+//==============================================================================
+//
+// Constants and table settings shared by the stepping simulation and the
+// event solver.
+//
+//==============================================================================
+#include "pockets.h"
+
+// Fixed step length (seconds) and the refresh rate the original per-frame
+// increments were tuned for. Velocities are stored in table units per second.
+const double SIM_FIXED_DT = 1.0 / 120.0;
+const float SIM_REFERENCE_HZ = 60.0f;
+
+// Longest frame the accumulator will accept before dropping time, so a stall
+// (window drag, breakpoint) doesn't turn into hundreds of catch-up steps.
+const double SIM_MAX_FRAME_TIME = 0.25;
+
+// Most increments a fixed step is split into (see SimConfig::substepTravel)
+const int SIM_MAX_SUBSTEPS = 16;
+
+// Events raised during a step, OR'd together in the return of step()/advance()
+enum SimEvent
+{
+    SIM_EVENT_NONE = 0,
+    SIM_EVENT_BALL_HIT = 1 << 0,    // Two balls touched
+    SIM_EVENT_POCKET = 1 << 1,      // A ball dropped into a pocket
+    SIM_EVENT_CUE_HIT = 1 << 2,     // The cue struck the cue ball
+    SIM_EVENT_REST = 1 << 3,        // The last moving ball came to rest
+    SIM_EVENT_CUSHION = 1 << 4      // A ball bounced off a cushion
+};
+
+
+// How Simulation::step() moves the balls
+enum SimSolver
+{
+    SIM_SOLVER_STEP,        // Fixed increments with overlap tests
+    SIM_SOLVER_EVENT        // Jump between analytically predicted collisions
+};
+
+
+// Table dimensions and decay constants
+struct SimConfig
+{
+    // Environmental Boundaries (limits for the centre of a ball)
+    float tableback = -110.0f;      // Farthest away at start
+    float tablefront = 110.0f;      // Closest to camera at start
+    float tableleft = -45.0f;
+    float tableright = 45.0f;
+
+    // Fraction of speed lost when bouncing off the side / end cushions
+    float cushionDecayX = 0.28f;
+    float cushionDecayZ = 0.30f;
+
+    // Speed kept (and reversed) by each ball after a ball to ball collision
+    float strikerKeepX = 0.85f;
+    float strikerKeepZ = 0.80f;
+    float struckKeepX = 0.90f;
+    float struckKeepZ = 0.85f;
+
+    float ballDiameter = 5.0f;
+
+    // Cloth friction as a deceleration (units per second squared) while a
+    // ball skids and once it rolls. Zero keeps balls at constant speed
+    // between collisions, as the original game did.
+    float slideFriction = 0.0f;
+    float rollFriction = 0.0f;
+
+    // Ball to ball restitution. Zero uses the keep factors above; anything
+    // else exchanges speed along the line of centres, which friction needs
+    // as a stopped ball has no velocity of its own to reverse.
+    float ballRestitution = 0.0f;
+
+    // Balls slower than this (units per second) after a bounce come to rest
+    // and are left alone until something hits them
+    float sleepSpeed = 2.0f;
+
+    // Furthest the fastest ball may travel in one increment of the fixed
+    // stepper, as a share of its radius. Fast steps are split into as many
+    // increments as that takes, up to SIM_MAX_SUBSTEPS, so a break doesn't
+    // sail past the cushions and through other balls. Zero keeps one
+    // increment per step, as the original game did.
+    float substepTravel = 0.0f;
+
+    // Capture circles, replaced when a table file is loaded
+    PocketSet pockets = PocketSet::sixPocket(-45.0f, 45.0f, -110.0f, 110.0f, 5.0f, 2.0f);
+
+    // TableProfileId whose compiled kernels step this table, or -1 to read
+    // the settings above at run time. Set through useTableProfile(), which
+    // also sets the bounds, cushions, ball size and pockets to match.
+    int profile = -1;
+
+    // Field by field, as padding and unused pocket slots may differ between
+    // equal configs
+    bool operator==(const SimConfig& o) const
+    {
+        return this->tableback == o.tableback && this->tablefront == o.tablefront
+            && this->tableleft == o.tableleft && this->tableright == o.tableright
+            && this->cushionDecayX == o.cushionDecayX && this->cushionDecayZ == o.cushionDecayZ
+            && this->strikerKeepX == o.strikerKeepX && this->strikerKeepZ == o.strikerKeepZ
+            && this->struckKeepX == o.struckKeepX && this->struckKeepZ == o.struckKeepZ
+            && this->ballDiameter == o.ballDiameter
+            && this->slideFriction == o.slideFriction && this->rollFriction == o.rollFriction
+            && this->ballRestitution == o.ballRestitution && this->sleepSpeed == o.sleepSpeed
+            && this->substepTravel == o.substepTravel
+            && this->pockets == o.pockets && this->profile == o.profile;
+    }
+    bool operator!=(const SimConfig& o) const { return !(*this == o); }
+};
@@ -0,0 +1,224 @@
+#pragma once
+//==============================================================================
+//                                Sim Thread
+//==============================================================================
+//
+// Runs a Simulation on its own thread at the fixed step rate, so a slow frame
+// or a swap blocked on vsync never holds the physics up, and the physics
+// never holds up a frame.
+//
+// The render thread talks to it three ways, none of which block:
+//   - player inputs go in through a ring and are applied before the next step
+//   - after every step the balls and cue are published through a triple
+//     buffer; latest() gives the newest one
+//   - events raised by the steps are OR'd into a word that takeEvents() clears
+//   - until the cue strikes, each state also carries the aim preview for the
+//     table as it stands (see aimpreview.h), only worked out again when the
+//     shot changes
+//
+// Each published state carries the ball positions from before and after its
+// step. Drawing at alpha() between them runs one step behind the physics but
+// moves smoothly at any frame rate.
+//
+// Nothing else may touch the Simulation while the thread is running.
+//
+//==============================================================================
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+#include "aimpreview.h"
+#include "simulation.h"
+#include "spscring.h"
+#include "triplebuffer.h"
+
+// Inputs queued between two steps before new ones are dropped
+const size_t SIM_INPUT_QUEUE = 64;
+
+
+// One player action on its way to the simulation
+struct PlayerInput
+{
+    int type;
+    float value;
+    float seconds;          // When it happened, for recordings
+};
+
+// What the renderer needs from one step
+struct RenderState
+{
+    int count = 0;
+    float x[POOL_MAX_BALLS];
+    float z[POOL_MAX_BALLS];
+    float prevX[POOL_MAX_BALLS];        // Before the step
+    float prevZ[POOL_MAX_BALLS];
+    unsigned char flags[POOL_MAX_BALLS];
+
+    float cueZ = 0.0f;
+    bool cueHit = false;
+
+    unsigned long long step = 0;
+    double time = 0.0;                  // SimThread::now() the step was due at
+
+    AimPath aim = AimPath();
+
+    bool pocketed(int i) const { return (this->flags[i] & BALL_POCKETED) != 0; }
+    float ballX(int i, float alpha) const { return this->prevX[i] + (this->x[i] - this->prevX[i]) * alpha; }
+    float ballZ(int i, float alpha) const { return this->prevZ[i] + (this->z[i] - this->prevZ[i]) * alpha; }
+};
+
+
+class SimThread
+{
+public:
+    // Applies one input to the simulation, on the simulation thread once running
+    typedef std::function<void(Simulation&, const PlayerInput&)> InputHandler;
+
+    SimThread(Simulation& sim, InputHandler handler) : sim(sim), handler(handler)
+    {
+        this->publish(0.0);
+    }
+
+    ~SimThread() { this->stop(); }
+
+    void start()
+    {
+        if (this->thread.joinable())
+            return;
+        this->epoch = std::chrono::steady_clock::now();
+        this->running.store(true);
+        this->thread = std::thread(&SimThread::run, this);
+    }
+
+    void stop()
+    {
+        if (!this->thread.joinable())
+            return;
+        this->running.store(false);
+        this->thread.join();
+    }
+
+    // Queue an input for the next step. Before start() it is applied straight
+    // away. Returns false if the queue was full and the input dropped.
+    bool input(const PlayerInput& in)
+    {
+        if (!this->thread.joinable())
+        {
+            this->handler(this->sim, in);
+            this->publish(this->now());
+            return true;
+        }
+        return this->inputs.push(in);
+    }
+
+    // Newest published state
+    const RenderState& latest()
+    {
+        this->states.update();
+        return this->states.front();
+    }
+
+    // Events since the last call
+    unsigned takeEvents() { return this->events.exchange(SIM_EVENT_NONE); }
+
+    // Seconds since start(), on the clock the states are stamped with
+    double now() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - this->epoch).count();
+    }
+
+    // How far to draw between a state's before and after positions
+    float alpha(const RenderState& state) const
+    {
+        double a = (this->now() - state.time) / SIM_FIXED_DT;
+        return a < 0.0 ? 0.0f : (a > 1.0 ? 1.0f : (float)a);
+    }
+
+private:
+    Simulation& sim;
+    InputHandler handler;
+
+    std::thread thread;
+    std::atomic<bool> running{ false };
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    SpscRing<PlayerInput, SIM_INPUT_QUEUE> inputs;
+    TripleBuffer<RenderState> states;
+    AimPreview preview;
+    std::atomic<unsigned> events{ SIM_EVENT_NONE };
+
+    void run()
+    {
+        double due = 0.0;
+        while (this->running.load())
+        {
+            const double elapsed = this->now();
+
+            // Drop time after a stall rather than racing to catch up
+            if (elapsed - due > SIM_MAX_FRAME_TIME)
+                due = elapsed - SIM_MAX_FRAME_TIME;
+
+            while (due <= elapsed)
+            {
+                PlayerInput in;
+                while (this->inputs.pop(in))
+                    this->handler(this->sim, in);
+
+                RenderState& out = this->states.back();
+                const BallTable& b = this->sim.balls;
+                for (int i = 0; i < b.count; i++)
+                {
+                    out.prevX[i] = b.x[i];
+                    out.prevZ[i] = b.z[i];
+                }
+
+                unsigned raised = this->sim.step();
+                if (raised)
+                    this->events.fetch_or(raised);
+
+                this->fill(out, due);
+                this->states.publish();
+                due += SIM_FIXED_DT;
+            }
+
+            std::this_thread::sleep_until(this->epoch + std::chrono::duration<double>(due));
+        }
+    }
+
+    // Everything but the before positions
+    void fill(RenderState& out, double time)
+    {
+        const Simulation& sim = this->sim;
+        const BallTable& b = sim.balls;
+        out.count = b.count;
+        for (int i = 0; i < b.count; i++)
+        {
+            out.x[i] = b.x[i];
+            out.z[i] = b.z[i];
+            out.flags[i] = b.flags[i];
+        }
+        out.cueZ = sim.cueZ;
+        out.cueHit = sim.cueHit;
+        out.step = sim.stepCount;
+        out.time = time;
+
+        // Each buffer keeps the last path it was given, so this is usually a compare
+        this->preview.update(sim);
+        if (out.aim.version != this->preview.current().version)
+            out.aim = this->preview.current();
+    }
+
+    // A state with no motion in it, for before the thread runs
+    void publish(double time)
+    {
+        RenderState& out = this->states.back();
+        this->fill(out, time);
+        for (int i = 0; i < out.count; i++)
+        {
+            out.prevX[i] = out.x[i];
+            out.prevZ[i] = out.z[i];
+        }
+        this->states.publish();
+    }
+};
@@ -0,0 +1,433 @@
+#pragma once
+//==============================================================================
+//                                Simulation
+//==============================================================================
+//
+// Headless pool table physics. Nothing in here depends on GLFW, GLEW or
+// Windows so it can be stepped from the game loop or from command line tools.
+//
+// The simulation always advances in fixed steps of SIM_FIXED_DT seconds. The
+// render loop hands advance() the real frame time and the accumulator works
+// out how many steps that is, so ball motion is identical at 60 Hz or 240 Hz.
+// The fixed stepper may split a step into smaller increments while balls
+// move fast (SimConfig::substepTravel); the step itself stays the same.
+//
+//==============================================================================
+#include <cmath>
+
+#include "simconfig.h"
+#include "balltable.h"
+#include "broadphase.h"
+#include "narrowphase.h"
+#include "motion.h"
+#include "eventsolver.h"
+#include "tableprofiles.h"
+#include "snapshot.h"
+#include "collisionevents.h"
+
+class Simulation;
+
+// How the fixed stepper split its steps into increments
+struct SubstepStats
+{
+    unsigned long long steps = 0;           // Fixed steps taken, with or without motion
+    unsigned long long movingSteps = 0;     // Of those, with a ball moving
+    unsigned long long increments = 0;
+    int most = 0;                           // Increments in the busiest step
+    unsigned long long histogram[SIM_MAX_SUBSTEPS + 1] = {};   // Steps by increment count
+
+    void add(int increments)
+    {
+        this->steps++;
+        this->movingSteps += increments > 0;
+        this->increments += increments;
+        this->most = increments > this->most ? increments : this->most;
+        this->histogram[increments]++;
+    }
+
+    void merge(const SubstepStats& other)
+    {
+        this->steps += other.steps;
+        this->movingSteps += other.movingSteps;
+        this->increments += other.increments;
+        this->most = other.most > this->most ? other.most : this->most;
+        for (int i = 0; i <= SIM_MAX_SUBSTEPS; i++)
+            this->histogram[i] += other.histogram[i];
+    }
+
+    double perMovingStep() const { return this->movingSteps ? (double)this->increments / this->movingSteps : 0.0; }
+};
+
+
+// Told about every fixed step, e.g. to record or check a session
+class StepObserver
+{
+public:
+    virtual ~StepObserver() {}
+    virtual void stepped(Simulation& sim, unsigned events) = 0;
+};
+
+
+class Simulation
+{
+public:
+    SimConfig config;
+    SimSolver solver = SIM_SOLVER_STEP;
+    BallTable balls;                // CUE_BALL first, then the balls to hit
+
+    float cueZ;
+    bool cueHit;
+
+    unsigned long long stepCount = 0;  // Steps since construction, kept over resets
+    double accumulator;
+
+    StepObserver* observer = nullptr;
+
+    // Gets a record of every collision if its queue is set (see
+    // collisionevents.h). Only the thread that steps may push to it.
+    CollisionSink collisions;
+
+    // Increments per fixed step so far, from the fixed stepper only. Not
+    // part of the table, so save() and restore() leave it alone.
+    SubstepStats substepStats;
+
+    // Broadphase scratch, rebuilt every step
+    BallGrid grid;
+
+    // Narrowphase, the fastest kernel the CPU supports unless overridden
+    ContactKernel contacts = contactKernel(detectContactPath());
+
+    // Used instead of fixed increments when solver is SIM_SOLVER_EVENT
+    EventSolver eventSolver;
+
+    Simulation() { this->reset(); }
+
+    // Place everything back in its original location
+    void reset()
+    {
+        this->balls.clear();
+        this->balls.add(0.0f, 43.0f, -1.0f * SIM_REFERENCE_HZ, -2.0f * SIM_REFERENCE_HZ);      // Cue ball
+        this->balls.add(-35.0f, -30.0f, 1.0f * SIM_REFERENCE_HZ, 1.5f * SIM_REFERENCE_HZ);     // Ball to hit
+
+        this->cueZ = 50.0f;
+        this->cueHit = false;
+
+        this->accumulator = 0.0;
+        this->eventSolver.invalidate();
+    }
+
+    // Copy the whole table state out, or put a saved one back. Neither
+    // allocates; the event solver re-predicts from the restored balls.
+    void save(TableSnapshot& out) const
+    {
+        out.config = this->config;
+        out.balls = this->balls;
+        out.cueZ = this->cueZ;
+        out.cueHit = this->cueHit;
+        out.solver = (unsigned char)this->solver;
+        out.stepCount = this->stepCount;
+        out.accumulator = this->accumulator;
+    }
+
+    void restore(const TableSnapshot& in)
+    {
+        this->config = in.config;
+        this->balls = in.balls;
+        this->cueZ = in.cueZ;
+        this->cueHit = in.cueHit;
+        this->solver = (SimSolver)in.solver;
+        this->stepCount = in.stepCount;
+        this->accumulator = in.accumulator;
+        this->eventSolver.invalidate();
+    }
+
+    // Player input: slide the cue along the table
+    void moveCue(float dz) { this->cueZ += dz; }
+
+    // Feed in the real time since the last frame and run as many fixed steps
+    // as it covers. Returns the events raised by all of those steps.
+    unsigned advance(double frameTime)
+    {
+        if (frameTime > SIM_MAX_FRAME_TIME)
+            frameTime = SIM_MAX_FRAME_TIME;
+
+        unsigned events = SIM_EVENT_NONE;
+        this->accumulator += frameTime;
+        while (this->accumulator >= SIM_FIXED_DT)
+        {
+            events |= this->step();
+            this->accumulator -= SIM_FIXED_DT;
+        }
+        return events;
+    }
+
+    // How far between the last two steps the current frame sits, 0..1
+    float alpha() const { return (float)(this->accumulator / SIM_FIXED_DT); }
+
+    // Advance the table by exactly one fixed step
+    unsigned step()
+    {
+        this->collisions.step = this->stepCount;
+        unsigned events = this->strike();
+
+        // A table at rest stays at rest until the cue or a reset moves something
+        if (!this->idle())
+        {
+            if (this->solver == SIM_SOLVER_EVENT)
+                events |= this->eventSolver.advance(this->balls, this->config, SIM_FIXED_DT, &this->collisions);
+            else
+                events |= this->substep((float)SIM_FIXED_DT);
+
+            if (this->idle())
+                events |= SIM_EVENT_REST;
+        }
+        else if (this->solver == SIM_SOLVER_STEP)
+            this->substepStats.add(0);
+
+        this->stepCount++;
+        if (this->observer)
+            this->observer->stepped(*this, events);
+        return events;
+    }
+
+    // Run the table for `seconds` of simulated time without a render loop.
+    // The event solver covers it in one jump; stepping takes fixed steps.
+    unsigned simulate(double seconds)
+    {
+        if (this->solver == SIM_SOLVER_EVENT)
+        {
+            this->collisions.step = this->stepCount;
+            unsigned events = this->strike();
+            events |= this->eventSolver.advance(this->balls, this->config, seconds, &this->collisions);
+            this->stepCount += (unsigned long long)(seconds / SIM_FIXED_DT);
+            return events;
+        }
+
+        unsigned events = SIM_EVENT_NONE;
+        for (double t = 0.0; t < seconds; t += SIM_FIXED_DT)
+        {
+            events |= this->step();
+
+            // Nothing can change from here on, count the rest as done
+            if (this->idle() && this->cueHit)
+            {
+                this->stepCount += (unsigned long long)((seconds - t) / SIM_FIXED_DT);
+                break;
+            }
+        }
+        return events;
+    }
+
+    // True once every ball has come to rest
+    bool idle() const { return !this->balls.anyMoving(); }
+
+    // Check for cue hit on ball if cue hasnt hit anything
+    unsigned strike()
+    {
+        BallTable& b = this->balls;
+        if (this->cueHit || this->cueZ - 2 > b.z[CUE_BALL])
+            return SIM_EVENT_NONE;
+
+        b.z[CUE_BALL] = this->cueZ - 0.01f;
+        b.flags[CUE_BALL] |= BALL_MOVING;
+        this->cueHit = true;
+        this->eventSolver.invalidate();
+        return SIM_EVENT_CUE_HIT;
+    }
+
+    // One fixed step as substepCount() increments. Stops early if the table
+    // comes to rest part way.
+    unsigned substep(float dt)
+    {
+        const int n = this->substepCount(dt);
+        this->substepStats.add(n);
+
+        unsigned events = SIM_EVENT_NONE;
+        const float h = dt / n;
+        for (int s = 0; s < n && !this->idle(); s++)
+            events |= this->increment(h);
+        return events;
+    }
+
+    // Increments needed for the fastest ball to move no more than
+    // config.substepTravel of its radius in each
+    int substepCount(float dt) const
+    {
+        const float travel = this->config.substepTravel * 0.5f * this->config.ballDiameter;
+        if (travel <= 0.0f)
+            return 1;
+
+        const BallTable& b = this->balls;
+        float fastest2 = 0.0f;
+        for (int i = 0; i < b.count; i++)
+        {
+            float v2 = b.vx[i] * b.vx[i] + b.vz[i] * b.vz[i];
+            fastest2 = (b.flags[i] & BALL_MOVING) && v2 > fastest2 ? v2 : fastest2;
+        }
+
+        const float n = std::ceil(std::sqrt(fastest2) * dt / travel);
+        return n < 1.0f ? 1 : (n > (float)SIM_MAX_SUBSTEPS ? SIM_MAX_SUBSTEPS : (int)n);
+    }
+
+    // One fixed increment: pockets, cushions, move, then ball contacts. Runs
+    // the kernel compiled for config.profile if there is one.
+    unsigned increment(float dt)
+    {
+        return (this->*this->incrementKernel())(dt);
+    }
+
+    typedef unsigned (Simulation::*IncrementKernel)(float);
+
+    // Dispatch table, indexed like TABLE_PROFILES. A table holding more balls
+    // than its profile allows falls back to the run time kernel.
+    IncrementKernel incrementKernel() const
+    {
+        static const IncrementKernel kernels[] =
+        {
+            &Simulation::incrementFor<FixedTable<Pool7ft>>,
+            &Simulation::incrementFor<FixedTable<Pool8ft>>,
+            &Simulation::incrementFor<FixedTable<Pool9ft>>,
+            &Simulation::incrementFor<FixedTable<Snooker12ft>>
+        };
+        static_assert(sizeof(kernels) / sizeof(kernels[0]) == TABLE_PROFILE_COUNT, "One kernel per table profile");
+
+        const int p = this->config.profile;
+        if (p >= 0 && p < TABLE_PROFILE_COUNT && this->balls.count <= TABLE_PROFILES[p].balls)
+            return kernels[p];
+        return &Simulation::incrementFor<ConfigTable>;
+    }
+
+    // increment() for one way of reading the table (see tableprofiles.h)
+    template <typename Table>
+    unsigned incrementFor(float dt)
+    {
+        unsigned events = SIM_EVENT_NONE;
+        BallTable& b = this->balls;
+
+        if (this->pocketCollision(b))
+            events |= SIM_EVENT_POCKET;
+
+        if (this->tableCollision<Table>(b))
+            events |= SIM_EVENT_CUSHION;
+        advanceBalls(b, this->config, dt, Table::balls(b));
+
+        if (this->ballsCollision<Table>(b))
+            events |= SIM_EVENT_BALL_HIT;
+
+        b.settle(this->config.sleepSpeed);
+        return events;
+    }
+
+    // Bounce moving balls off the cushions, losing some speed. Spin is left
+    // alone, so with friction on the ball skids for a moment afterwards.
+    // Returns true if any did.
+    template <typename Table = ConfigTable>
+    bool tableCollision(BallTable& b) const
+    {
+        const SimConfig& c = this->config;
+        const float left = Table::left(c), right = Table::right(c);
+        const float back = Table::back(c), front = Table::front(c);
+        const float keepX = -(1.0f - Table::cushionDecayX(c));
+        const float keepZ = -(1.0f - Table::cushionDecayZ(c));
+
+        const int n = Table::balls(b);
+        unsigned char bounced[POOL_MAX_BALLS];     // 1 off a side, 2 off an end
+        unsigned char any = 0;
+        for (int i = 0; i < n; i++)
+        {
+            bool moving = (b.flags[i] & BALL_MOVING) != 0;
+            float x = b.x[i];
+            float z = b.z[i];
+
+            // Check for collisions left or right of table
+            bool hitX = moving && (x >= right || x <= left);
+            b.vx[i] = hitX ? b.vx[i] * keepX : b.vx[i];
+            b.x[i] = hitX ? (x > 0 ? right : left) : x;
+
+            // Check for collisions front or back of table
+            bool hitZ = moving && (z >= front || z <= back);
+            b.vz[i] = hitZ ? b.vz[i] * keepZ : b.vz[i];
+            b.z[i] = hitZ ? (z > 0 ? front : back) : z;
+
+            bounced[i] = (unsigned char)(hitX | (hitZ << 1));
+            any |= bounced[i];
+        }
+
+        // Speed into the cushion, from the speed kept coming off it
+        if (any && this->collisions.listening())
+        {
+            for (int i = 0; i < n; i++)
+            {
+                float speedX = (bounced[i] & 1) && keepX != 0.0f ? std::fabs(b.vx[i] / keepX) : 0.0f;
+                float speedZ = (bounced[i] & 2) && keepZ != 0.0f ? std::fabs(b.vz[i] / keepZ) : 0.0f;
+                if (bounced[i])
+                    this->collisions.report(SIM_EVENT_CUSHION, i, -1, b.x[i], b.z[i], speedX > speedZ ? speedX : speedZ);
+            }
+        }
+        return any != 0;
+    }
+
+    // Test each ball against its neighbours from the grid. Returns true if any touched.
+    template <typename Table = ConfigTable>
+    bool ballsCollision(BallTable& b)
+    {
+        const SimConfig& c = this->config;
+        const float diameter = Table::ballDiameter(c);
+        const float diameter2 = diameter * diameter;
+        this->grid.build(b, Table::left(c), Table::back(c), Table::right(c) - Table::left(c), diameter);
+
+        int others[POOL_MAX_BALLS];
+        int hits[POOL_MAX_BALLS];
+        bool any = false;
+
+        // Only moving balls look for contacts; a resting ball is found from
+        // the moving ball that reaches it. Balls woken during the pass wait
+        // for the next step.
+        const int count = Table::balls(b);
+        unsigned char flags[POOL_MAX_BALLS];
+        for (int i = 0; i < count; i++)
+            flags[i] = b.flags[i];
+
+        for (int i = 0; i < count; i++)
+        {
+            if (!(flags[i] & BALL_MOVING))
+                continue;
+
+            int n = this->grid.wakeNeighbours(flags, i, others);
+            if (n == 0)
+                continue;
+
+            n = this->contacts(b, i, others, n, diameter2, hits);
+            for (int k = 0; k < n; k++)
+            {
+                const int lo = i < hits[k] ? i : hits[k];
+                const int hi = i < hits[k] ? hits[k] : i;
+                const float closing = this->collisions.listening() ? closingSpeed(b, lo, hi) : 0.0f;
+                if (!ballsResponse(b, c, lo, hi))
+                    continue;
+
+                any = true;
+                this->collisions.report(SIM_EVENT_BALL_HIT, lo, hi, 0.5f * (b.x[lo] + b.x[hi]),
+                    0.5f * (b.z[lo] + b.z[hi]), closing > 0.0f ? closing : 0.0f);
+            }
+        }
+        return any;
+    }
+
+    // Drop every ball that has rolled into one of the table's pockets.
+    // Returns the balls that dropped this step.
+    BallMask pocketCollision(BallTable& b) const
+    {
+        BallMask dropped = this->config.pockets.capture(b);
+        for (int i = 0; i < b.count; i++)
+        {
+            if (dropped & ((BallMask)1 << i))
+            {
+                b.flags[i] = BALL_POCKETED;
+                this->collisions.report(SIM_EVENT_POCKET, i, -1, b.x[i], b.z[i],
+                    std::sqrt(b.vx[i] * b.vx[i] + b.vz[i] * b.vz[i]));
+            }
+        }
+        return dropped;
+    }
+};
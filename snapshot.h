@@ -0,0 +1,76 @@
+#pragma once
+//==============================================================================
+//                                Snapshot
+//==============================================================================
+//
+// Everything needed to put a table back exactly as it was, in one plain
+// struct. Saving and restoring are a copy of about a kilobyte with no heap
+// in sight, so search, rollback and undo can fork a table as often as they
+// like.
+//
+// The event solver's queue is not part of a snapshot. It only caches
+// predictions made from the balls, so a restored table rebuilds it on its
+// next step. Every table restored from one snapshot plays on identically,
+// but with the event solver not bit for bit like the table that was saved,
+// whose predictions were made at other times.
+//
+// tableHash() is the hash session recordings store (see replay.h), so a
+// snapshot hash can be compared against a recorded game as well as used as a
+// transposition key.
+//
+//==============================================================================
+#include <cstddef>
+#include <type_traits>
+
+#include "simconfig.h"
+#include "balltable.h"
+
+struct TableSnapshot
+{
+    SimConfig config;
+    BallTable balls;
+    float cueZ;
+    bool cueHit;
+    unsigned char solver;               // SimSolver
+    unsigned long long stepCount;
+    double accumulator;
+
+    unsigned hash() const;
+};
+
+static_assert(std::is_trivially_copyable<TableSnapshot>::value, "TableSnapshot is copied as raw bytes");
+
+
+// FNV-1a over the state the physics moves: the first count slots of each
+// ball array, the ball flags, cueZ and cueHit. Slots past the ball count and
+// padding are left out, so equal tables always hash equal. The SimConfig the
+// table runs under is not hashed; compare it separately where it can change.
+inline unsigned tableHash(const BallTable& b, float cueZ, bool cueHit)
+{
+    unsigned h = 2166136261u;
+    auto mix = [&h](const void* data, size_t size)
+    {
+        const unsigned char* p = (const unsigned char*)data;
+        for (size_t i = 0; i < size; i++)
+            h = (h ^ p[i]) * 16777619u;
+    };
+
+    const size_t n = (size_t)b.count;
+    mix(&b.count, sizeof(b.count));
+    mix(b.x, n * sizeof(float));
+    mix(b.z, n * sizeof(float));
+    mix(b.vx, n * sizeof(float));
+    mix(b.vz, n * sizeof(float));
+    mix(b.rx, n * sizeof(float));
+    mix(b.rz, n * sizeof(float));
+    mix(b.flags, n);
+    mix(&cueZ, sizeof(cueZ));
+    unsigned char hit = cueHit ? 1 : 0;
+    mix(&hit, 1);
+    return h;
+}
+
+inline unsigned TableSnapshot::hash() const
+{
+    return tableHash(this->balls, this->cueZ, this->cueHit);
+}
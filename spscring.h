@@ -0,0 +1,58 @@
+#pragma once
+//==============================================================================
+//                                SPSC Ring
+//==============================================================================
+//
+// Fixed size queue for one producer thread and one consumer thread, with no
+// locks and no allocation. Each side only writes its own index, and the
+// index is published after the slot it covers, so a release store and an
+// acquire load are all the synchronisation needed.
+//
+// Capacity must be a power of two; one slot is always left empty to tell a
+// full ring from an empty one.
+//
+//==============================================================================
+#include <atomic>
+#include <cstddef>
+
+template <typename T, size_t Capacity>
+class SpscRing
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+    // Producer: false if the ring is full and the item was dropped
+    bool push(const T& item)
+    {
+        const size_t tail = this->tail.load(std::memory_order_relaxed);
+        const size_t next = (tail + 1) & (Capacity - 1);
+        if (next == this->head.load(std::memory_order_acquire))
+            return false;
+        this->items[tail] = item;
+        this->tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: false if there was nothing to take
+    bool pop(T& out)
+    {
+        const size_t head = this->head.load(std::memory_order_relaxed);
+        if (head == this->tail.load(std::memory_order_acquire))
+            return false;
+        out = this->items[head];
+        this->head.store((head + 1) & (Capacity - 1), std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const
+    {
+        return this->head.load(std::memory_order_acquire) == this->tail.load(std::memory_order_acquire);
+    }
+
+private:
+    T items[Capacity];
+
+    // Kept a cache line apart so the two threads don't fight over one line
+    alignas(64) std::atomic<size_t> head{ 0 };
+    alignas(64) std::atomic<size_t> tail{ 0 };
+};
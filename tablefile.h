@@ -0,0 +1,160 @@
+#pragma once
+//==============================================================================
+//                                Table File
+//==============================================================================
+//
+// Loads a SimConfig from a plain text table description, one setting per
+// line. Blank lines and lines starting with # are ignored. Any setting left
+// out keeps its current value; if the file lists pockets they replace the
+// current set.
+//
+//     tableleft -45
+//     cushionDecayX 0.28
+//     pocket 45 -110 5        (x, z, capture radius)
+//
+// "profile 9ft" starts from one of the compiled table profiles (see
+// tableprofiles.h). The profile fixes the bounds, cushions and ball size, so
+// after it only the other settings and the pockets may be changed.
+//
+// saveTableFile() writes a config back out in the same form.
+//
+//==============================================================================
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "simconfig.h"
+#include "tableprofiles.h"
+
+// Settings a table file can change, by the name used in the file
+inline float* tableSetting(SimConfig& config, const std::string& name)
+{
+    if (name == "tableback") return &config.tableback;
+    if (name == "tablefront") return &config.tablefront;
+    if (name == "tableleft") return &config.tableleft;
+    if (name == "tableright") return &config.tableright;
+    if (name == "cushionDecayX") return &config.cushionDecayX;
+    if (name == "cushionDecayZ") return &config.cushionDecayZ;
+    if (name == "strikerKeepX") return &config.strikerKeepX;
+    if (name == "strikerKeepZ") return &config.strikerKeepZ;
+    if (name == "struckKeepX") return &config.struckKeepX;
+    if (name == "struckKeepZ") return &config.struckKeepZ;
+    if (name == "ballDiameter") return &config.ballDiameter;
+    if (name == "slideFriction") return &config.slideFriction;
+    if (name == "rollFriction") return &config.rollFriction;
+    if (name == "ballRestitution") return &config.ballRestitution;
+    if (name == "sleepSpeed") return &config.sleepSpeed;
+    if (name == "substepTravel") return &config.substepTravel;
+    return nullptr;
+}
+
+// Every setting tableSetting() knows, in the order saveTableFile() writes them
+const char* const TABLE_SETTING_NAMES[] =
+{
+    "tableback", "tablefront", "tableleft", "tableright",
+    "cushionDecayX", "cushionDecayZ",
+    "strikerKeepX", "strikerKeepZ", "struckKeepX", "struckKeepZ",
+    "ballDiameter", "slideFriction", "rollFriction", "ballRestitution", "sleepSpeed", "substepTravel"
+};
+
+// Settings a table profile compiles into its kernels
+inline bool tableSettingFixedByProfile(const std::string& name)
+{
+    return name == "tableback" || name == "tablefront" || name == "tableleft" || name == "tableright"
+        || name == "cushionDecayX" || name == "cushionDecayZ" || name == "ballDiameter";
+}
+
+// Returns false (leaving config untouched) if the file can't be read or
+// parsed. Why goes to `error` as one line if given, and is printed if not.
+inline bool loadTableFile(const char* path, SimConfig& config, std::string* error = nullptr)
+{
+    auto fail = [&](const char* code, const char* reason, const std::string& where)
+    {
+        if (error)
+            *error = std::string(reason) + " " + where;
+        else
+            std::cout << "ERROR::TABLE::" << code << " " << where << std::endl;
+        return false;
+    };
+
+    std::ifstream file(path);
+    if (!file)
+        return fail("FILE_NOT_SUCCESFULLY_READ", "cannot read", path);
+
+    SimConfig loaded = config;
+    PocketSet pockets;
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        std::istringstream in(line);
+        std::string key;
+        if (!(in >> key) || key[0] == '#')
+            continue;
+
+        bool ok;
+        if (key == "pocket")
+        {
+            float x, z, radius;
+            ok = (in >> x >> z >> radius) && pockets.add(x, z, radius);
+        }
+        else if (key == "profile")
+        {
+            std::string name;
+            ok = (in >> name) && useTableProfile(loaded, findTableProfile(name.c_str()));
+        }
+        else if (loaded.profile >= 0 && tableSettingFixedByProfile(key))
+            return fail("FIXED_BY_PROFILE", "fixed by profile", std::string(path) + ":" + std::to_string(lineNumber) + " " + line);
+        else
+        {
+            float* value = tableSetting(loaded, key);
+            ok = value && (in >> *value);
+        }
+
+        if (!ok)
+            return fail("BAD_LINE", "bad line", std::string(path) + ":" + std::to_string(lineNumber) + " " + line);
+    }
+
+    if (pockets.count > 0)
+        loaded.pockets = pockets;
+    config = loaded;
+    return true;
+}
+
+// Write every setting and pocket, starting with the profile if there is one.
+// Each line of `comment` goes at the top as a # comment.
+inline bool saveTableFile(const char* path, const SimConfig& config, const std::string& comment = "")
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file)
+    {
+        std::cout << "ERROR::TABLE::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+
+    std::istringstream lines(comment);
+    std::string line;
+    while (std::getline(lines, line))
+        file << "# " << line << "\n";
+    if (!comment.empty())
+        file << "\n";
+
+    SimConfig values = config;
+    file << std::setprecision(7);
+    if (config.profile >= 0)
+        file << "profile " << TABLE_PROFILES[config.profile].name << "\n";
+    for (const char* name : TABLE_SETTING_NAMES)
+    {
+        if (config.profile < 0 || !tableSettingFixedByProfile(name))
+            file << name << " " << *tableSetting(values, name) << "\n";
+    }
+
+    file << "\n";
+    for (int p = 0; p < config.pockets.count; p++)
+        file << "pocket " << config.pockets.x[p] << " " << config.pockets.z[p] << " " << config.pockets.radius[p] << "\n";
+    return (bool)file;
+}
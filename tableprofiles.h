@@ -0,0 +1,167 @@
+#pragma once
+//==============================================================================
+//                                Table Profiles
+//==============================================================================
+//
+// Standard table sizes known at compile time. Each profile is a type whose
+// bounds, cushion and ball constants are constexpr, and the stepping kernels
+// in Simulation are templated on it, so for a profile the compiler folds the
+// bounds into the code and sees a fixed trip count over the balls.
+//
+// Profiles are still picked at run time: SimConfig::profile indexes
+// TABLE_PROFILES (or -1 for none), and Simulation looks the matching kernel
+// up in its dispatch table each step. Without a profile the same kernels run
+// on the values in SimConfig, which is what table files and the game use.
+//
+// Distances are in table units, about 11.4 mm: a pool ball (57 mm) is 5
+// across. Bounds are limits for the centre of a ball.
+//
+//==============================================================================
+#include <cstring>
+
+#include "simconfig.h"
+#include "balltable.h"
+
+struct Pool7ft
+{
+    static constexpr float halfLength = 84.4f;
+    static constexpr float halfWidth = 41.0f;
+    static constexpr float ballDiameter = 5.0f;
+    static constexpr float cushionDecayX = 0.28f;
+    static constexpr float cushionDecayZ = 0.30f;
+    static constexpr float cornerPocket = 5.0f;
+    static constexpr float sidePocket = 3.0f;
+    static constexpr int balls = 16;
+};
+
+struct Pool8ft
+{
+    static constexpr float halfLength = 95.5f;
+    static constexpr float halfWidth = 46.5f;
+    static constexpr float ballDiameter = 5.0f;
+    static constexpr float cushionDecayX = 0.28f;
+    static constexpr float cushionDecayZ = 0.30f;
+    static constexpr float cornerPocket = 5.0f;
+    static constexpr float sidePocket = 3.0f;
+    static constexpr int balls = 16;
+};
+
+struct Pool9ft
+{
+    static constexpr float halfLength = 108.9f;
+    static constexpr float halfWidth = 53.2f;
+    static constexpr float ballDiameter = 5.0f;
+    static constexpr float cushionDecayX = 0.28f;
+    static constexpr float cushionDecayZ = 0.30f;
+    static constexpr float cornerPocket = 5.0f;
+    static constexpr float sidePocket = 3.0f;
+    static constexpr int balls = 16;
+};
+
+// 12 ft snooker table, 52.5 mm balls
+struct Snooker12ft
+{
+    static constexpr float halfLength = 154.2f;
+    static constexpr float halfWidth = 75.7f;
+    static constexpr float ballDiameter = 4.6f;
+    static constexpr float cushionDecayX = 0.30f;
+    static constexpr float cushionDecayZ = 0.32f;
+    static constexpr float cornerPocket = 4.0f;
+    static constexpr float sidePocket = 3.5f;
+    static constexpr int balls = 22;
+};
+
+static_assert(Snooker12ft::balls <= POOL_MAX_BALLS, "BallTable too small for a snooker set");
+
+
+// How a kernel reads the table. Both give the same answers for a table set
+// up from a profile; FixedTable just gives them at compile time.
+struct ConfigTable
+{
+    static float left(const SimConfig& c) { return c.tableleft; }
+    static float right(const SimConfig& c) { return c.tableright; }
+    static float back(const SimConfig& c) { return c.tableback; }
+    static float front(const SimConfig& c) { return c.tablefront; }
+    static float ballDiameter(const SimConfig& c) { return c.ballDiameter; }
+    static float cushionDecayX(const SimConfig& c) { return c.cushionDecayX; }
+    static float cushionDecayZ(const SimConfig& c) { return c.cushionDecayZ; }
+    static int balls(const BallTable& b) { return b.count; }
+};
+
+template <typename Profile>
+struct FixedTable
+{
+    static constexpr float left(const SimConfig&) { return -Profile::halfWidth; }
+    static constexpr float right(const SimConfig&) { return Profile::halfWidth; }
+    static constexpr float back(const SimConfig&) { return -Profile::halfLength; }
+    static constexpr float front(const SimConfig&) { return Profile::halfLength; }
+    static constexpr float ballDiameter(const SimConfig&) { return Profile::ballDiameter; }
+    static constexpr float cushionDecayX(const SimConfig&) { return Profile::cushionDecayX; }
+    static constexpr float cushionDecayZ(const SimConfig&) { return Profile::cushionDecayZ; }
+
+    // Every slot the profile can hold; unused ones are zeroed and never move
+    static constexpr int balls(const BallTable&) { return Profile::balls; }
+};
+
+
+// Set a SimConfig up for a profile, leaving friction and the other
+// settings the profile doesn't fix alone
+template <typename Profile>
+void configureProfile(SimConfig& c, int id)
+{
+    c.tableleft = -Profile::halfWidth;
+    c.tableright = Profile::halfWidth;
+    c.tableback = -Profile::halfLength;
+    c.tablefront = Profile::halfLength;
+    c.ballDiameter = Profile::ballDiameter;
+    c.cushionDecayX = Profile::cushionDecayX;
+    c.cushionDecayZ = Profile::cushionDecayZ;
+    c.pockets = PocketSet::sixPocket(-Profile::halfWidth, Profile::halfWidth,
+        -Profile::halfLength, Profile::halfLength, Profile::cornerPocket, Profile::sidePocket);
+    c.profile = id;
+}
+
+enum TableProfileId
+{
+    TABLE_POOL_7FT,
+    TABLE_POOL_8FT,
+    TABLE_POOL_9FT,
+    TABLE_SNOOKER,
+    TABLE_PROFILE_COUNT
+};
+
+struct TableProfile
+{
+    const char* name;
+    int balls;                              // Most balls the kernels handle
+    void (*configure)(SimConfig&, int);
+};
+
+// Indexed by TableProfileId
+const TableProfile TABLE_PROFILES[TABLE_PROFILE_COUNT] =
+{
+    { "7ft", Pool7ft::balls, configureProfile<Pool7ft> },
+    { "8ft", Pool8ft::balls, configureProfile<Pool8ft> },
+    { "9ft", Pool9ft::balls, configureProfile<Pool9ft> },
+    { "snooker", Snooker12ft::balls, configureProfile<Snooker12ft> }
+};
+
+// Profile id by name, or -1
+inline int findTableProfile(const char* name)
+{
+    for (int i = 0; i < TABLE_PROFILE_COUNT; i++)
+    {
+        if (strcmp(TABLE_PROFILES[i].name, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+// Returns false for an unknown id
+inline bool useTableProfile(SimConfig& c, int id)
+{
+    if (id < 0 || id >= TABLE_PROFILE_COUNT)
+        return false;
+    TABLE_PROFILES[id].configure(c, id);
+    return true;
+}
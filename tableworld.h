@@ -0,0 +1,162 @@
+#pragma once
+//==============================================================================
+//                                Table World
+//==============================================================================
+//
+// Many independent tables in one process, e.g. to check a league's worth of
+// games at once. Every table is its own Simulation, so tables share nothing
+// and can be stepped on any thread.
+//
+// stepWorld() advances every table by the same number of fixed steps. The
+// tables are cut into a few contiguous shards per core and each shard runs
+// the whole batch of steps on one worker before moving on, so a table stays
+// in that core's cache for the batch rather than being handed around every
+// step. A table whose balls have all stopped after the cue struck is skipped
+// for the rest of the batch; its step count still moves on.
+//
+//==============================================================================
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "simulation.h"
+#include "threadpool.h"
+
+// Shards dealt to each worker per batch. More balances uneven tables better,
+// fewer keeps more of each core's tables together.
+const unsigned WORLD_SHARDS_PER_WORKER = 4;
+
+
+class TableWorld
+{
+public:
+    // Add a copy of `table` and return its id. Ids of removed tables are reused.
+    unsigned add(const Simulation& table)
+    {
+        unsigned id;
+        if (!this->freeIds.empty())
+        {
+            id = this->freeIds.back();
+            this->freeIds.pop_back();
+            this->tables[id] = table;
+            this->live[id] = 1;
+        }
+        else
+        {
+            id = (unsigned)this->tables.size();
+            this->tables.push_back(table);
+            this->live.push_back(1);
+        }
+        this->tables[id].observer = nullptr;
+        this->tables[id].collisions.queue = nullptr;
+        this->tables[id].collisions.listener = nullptr;
+        this->liveCount++;
+        return id;
+    }
+
+    bool remove(unsigned id)
+    {
+        if (!this->contains(id))
+            return false;
+        this->live[id] = 0;
+        this->freeIds.push_back(id);
+        this->liveCount--;
+        return true;
+    }
+
+    bool contains(unsigned id) const { return id < this->tables.size() && this->live[id]; }
+
+    // nullptr if there is no such table
+    Simulation* table(unsigned id) { return this->contains(id) ? &this->tables[id] : nullptr; }
+
+    size_t size() const { return this->liveCount; }
+
+    // Slots, live or not, for walking the whole world by index
+    size_t slots() const { return this->tables.size(); }
+    bool isLive(size_t slot) const { return this->live[slot] != 0; }
+    Simulation& slot(size_t slot) { return this->tables[slot]; }
+
+private:
+    std::vector<Simulation> tables;
+    std::vector<unsigned char> live;
+    std::vector<unsigned> freeIds;
+    size_t liveCount = 0;
+};
+
+
+// What one call to stepWorld() did
+struct WorldStats
+{
+    unsigned long long tables = 0;
+    unsigned long long tableSteps = 0;      // Fixed steps covered, summed over tables
+    unsigned long long computedSteps = 0;   // Of those, steps with balls still moving
+    unsigned events = SIM_EVENT_NONE;       // Everything raised on any table
+    double seconds = 0.0;
+
+    // Fold a later batch into a running total
+    void add(const WorldStats& batch)
+    {
+        this->tables = batch.tables;
+        this->tableSteps += batch.tableSteps;
+        this->computedSteps += batch.computedSteps;
+        this->events |= batch.events;
+        this->seconds += batch.seconds;
+    }
+
+    double tableStepsPerSecond() const { return this->seconds > 0.0 ? this->tableSteps / this->seconds : 0.0; }
+};
+
+// Step every table in the world `steps` fixed steps across the pool
+inline WorldStats stepWorld(ThreadPool& pool, TableWorld& world, unsigned steps)
+{
+    WorldStats stats;
+    auto start = std::chrono::steady_clock::now();
+
+    const size_t slots = world.slots();
+    const size_t shards = (size_t)pool.size() * WORLD_SHARDS_PER_WORKER;
+    const size_t grain = (slots + shards - 1) / shards;
+
+    std::atomic<unsigned long long> tables{ 0 };
+    std::atomic<unsigned long long> computed{ 0 };
+    std::atomic<unsigned> events{ SIM_EVENT_NONE };
+
+    pool.parallelFor(slots, grain,
+        [&](size_t begin, size_t end, unsigned)
+        {
+            // Totals for the shard, published once at the end
+            unsigned long long shardTables = 0;
+            unsigned long long shardComputed = 0;
+            unsigned shardEvents = SIM_EVENT_NONE;
+
+            for (size_t i = begin; i < end; i++)
+            {
+                if (!world.isLive(i))
+                    continue;
+                Simulation& sim = world.slot(i);
+                shardTables++;
+
+                for (unsigned s = 0; s < steps; s++)
+                {
+                    // Nothing can change until the next input
+                    if (sim.cueHit && sim.idle())
+                    {
+                        sim.stepCount += steps - s;
+                        break;
+                    }
+                    shardEvents |= sim.step();
+                    shardComputed++;
+                }
+            }
+
+            tables.fetch_add(shardTables);
+            computed.fetch_add(shardComputed);
+            events.fetch_or(shardEvents);
+        });
+
+    stats.tables = tables.load();
+    stats.tableSteps = stats.tables * steps;
+    stats.computedSteps = computed.load();
+    stats.events = events.load();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
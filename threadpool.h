@@ -0,0 +1,177 @@
+#pragma once
+//==============================================================================
+//                                Thread Pool
+//==============================================================================
+//
+// Fixed set of worker threads for splitting a loop over all cores. Each call
+// to parallelFor() cuts the range into chunks and deals them out round robin
+// to per-worker queues. A worker takes chunks from the back of its own queue
+// and, once that is empty, steals from the front of the others, so uneven
+// chunks (a long break shot next to a quick miss) still balance out.
+//
+// parallelFor() blocks until the whole range is done. It must not be called
+// from inside a job running on the same pool.
+//
+//==============================================================================
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+class ThreadPool
+{
+public:
+    // body(begin, end, worker) handles items [begin, end) on worker 0..size()-1
+    typedef std::function<void(size_t, size_t, unsigned)> Job;
+
+    // Zero threads means one per hardware thread
+    explicit ThreadPool(unsigned threads = 0)
+    {
+        if (threads == 0)
+            threads = std::thread::hardware_concurrency();
+        if (threads == 0)
+            threads = 1;
+
+        for (unsigned i = 0; i < threads; i++)
+            this->queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+        for (unsigned i = 0; i < threads; i++)
+            this->workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->wakeMutex);
+            this->stopping = true;
+        }
+        this->wake.notify_all();
+        for (size_t i = 0; i < this->workers.size(); i++)
+            this->workers[i].join();
+    }
+
+    unsigned size() const { return (unsigned)this->workers.size(); }
+
+    // Run body over [0, count) in chunks of at most grain items
+    void parallelFor(size_t count, size_t grain, const Job& body)
+    {
+        if (count == 0)
+            return;
+        if (grain == 0)
+            grain = 1;
+
+        this->remaining.store(count);
+
+        // Deal the chunks out before waking anyone
+        unsigned target = 0;
+        for (size_t begin = 0; begin < count; begin += grain)
+        {
+            Chunk chunk;
+            chunk.begin = begin;
+            chunk.end = begin + grain < count ? begin + grain : count;
+            chunk.job = &body;
+
+            WorkQueue& q = *this->queues[target];
+            {
+                std::lock_guard<std::mutex> lock(q.mutex);
+                q.chunks.push_back(chunk);
+            }
+            target = (target + 1) % this->size();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(this->wakeMutex);
+            this->generation++;
+        }
+        this->wake.notify_all();
+
+        std::unique_lock<std::mutex> lock(this->doneMutex);
+        this->done.wait(lock, [this] { return this->remaining.load() == 0; });
+    }
+
+private:
+    struct Chunk
+    {
+        size_t begin;
+        size_t end;
+        const Job* job;
+    };
+
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<Chunk> chunks;
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    unsigned long long generation = 0;
+    bool stopping = false;
+
+    std::mutex doneMutex;
+    std::condition_variable done;
+    std::atomic<size_t> remaining{ 0 };
+
+    // Newest chunk from our own queue
+    bool popLocal(unsigned worker, Chunk& out)
+    {
+        WorkQueue& q = *this->queues[worker];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.chunks.empty())
+            return false;
+        out = q.chunks.back();
+        q.chunks.pop_back();
+        return true;
+    }
+
+    // Oldest chunk from somebody else's queue
+    bool steal(unsigned worker, Chunk& out)
+    {
+        for (unsigned i = 1; i < this->size(); i++)
+        {
+            WorkQueue& q = *this->queues[(worker + i) % this->size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.chunks.empty())
+                continue;
+            out = q.chunks.front();
+            q.chunks.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    void workerLoop(unsigned worker)
+    {
+        unsigned long long seen = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(this->wakeMutex);
+                this->wake.wait(lock, [&] { return this->stopping || this->generation != seen; });
+                if (this->stopping)
+                    return;
+                seen = this->generation;
+            }
+
+            Chunk chunk;
+            while (this->popLocal(worker, chunk) || this->steal(worker, chunk))
+            {
+                (*chunk.job)(chunk.begin, chunk.end, worker);
+
+                size_t items = chunk.end - chunk.begin;
+                if (this->remaining.fetch_sub(items) == items)
+                {
+                    std::lock_guard<std::mutex> lock(this->doneMutex);
+                    this->done.notify_all();
+                }
+            }
+        }
+    }
+};
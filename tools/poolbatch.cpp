@@ -0,0 +1,137 @@
+//==============================================================================
+//                                PROGRAM:
+//                                Pool Batch
+//==============================================================================
+//
+// Headless Monte-Carlo runner for the opening shot. Plays the starting table
+// many times with the cue speed and angle jittered and prints how often each
+// ball is pocketed, plus where the object ball tends to come to rest.
+//
+// No GL or Windows libraries needed:
+//     g++ -std=c++14 -O2 -pthread -I.. poolbatch.cpp -o poolbatch
+//
+// Usage: poolbatch [shots] [threads] [--event] [--profile name] [--table file] [--speed mean sigma] [--angle mean sigma]
+//                  [--log file [--flush-thread]]
+//     Angles are in degrees. 0 threads uses every core.
+//     Profiles are 7ft, 8ft, 9ft and snooker; a table file is applied on top.
+//     --log writes every collision to an event log (see eventlog.h and
+//     poolevents), optionally from a background flush thread.
+//
+//==============================================================================
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "../simulation.h"
+#include "../shotbatch.h"
+#include "../tablefile.h"
+
+int main(int argc, char** argv)
+{
+    BatchSettings settings;
+    unsigned threads = 0;
+    bool eventSolver = false;
+    const char* tableFile = 0;
+    const char* profile = 0;
+    const char* logFile = 0;
+    bool flushThread = false;
+
+    // Default shot is the one the game plays: (-1, -2) units a frame at 60 Hz
+    ShotDistribution dist;
+    dist.mean.speed = 134.16f;
+    dist.mean.angle = -0.4636f;
+    dist.sigma.speed = 10.0f;
+    dist.sigma.angle = 0.02f;
+    dist.mean.spin = dist.sigma.spin = 0.0f;
+
+    int positional = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--event") == 0)
+            eventSolver = true;
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+            profile = argv[++i];
+        else if (strcmp(argv[i], "--table") == 0 && i + 1 < argc)
+            tableFile = argv[++i];
+        else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc)
+            logFile = argv[++i];
+        else if (strcmp(argv[i], "--flush-thread") == 0)
+            flushThread = true;
+        else if (strcmp(argv[i], "--speed") == 0 && i + 2 < argc)
+        {
+            dist.mean.speed = (float)atof(argv[++i]);
+            dist.sigma.speed = (float)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--angle") == 0 && i + 2 < argc)
+        {
+            dist.mean.angle = (float)(atof(argv[++i]) * 3.14159265358979 / 180.0);
+            dist.sigma.angle = (float)(atof(argv[++i]) * 3.14159265358979 / 180.0);
+        }
+        else if (argv[i][0] != '-' && positional == 0)
+        {
+            settings.shots = strtoull(argv[i], 0, 10);
+            positional++;
+        }
+        else if (argv[i][0] != '-' && positional == 1)
+        {
+            threads = (unsigned)atoi(argv[i]);
+            positional++;
+        }
+        else
+        {
+            printf("Usage: %s [shots] [threads] [--event] [--profile name] [--table file] [--speed mean sigma] [--angle mean sigma]\n", argv[0]);
+            printf("       [--log file [--flush-thread]]\n");
+            return 1;
+        }
+    }
+
+    Simulation table;
+    if (profile && !useTableProfile(table.config, findTableProfile(profile)))
+    {
+        printf("Unknown table profile %s\n", profile);
+        return 1;
+    }
+    if (tableFile && !loadTableFile(tableFile, table.config))
+        return 1;
+    table.solver = eventSolver ? SIM_SOLVER_EVENT : SIM_SOLVER_STEP;
+
+    EventLog log;
+    if (logFile)
+    {
+        if (!log.open(logFile, flushThread))
+            return 1;
+        settings.log = &log;
+    }
+
+    ThreadPool pool(threads);
+    auto start = std::chrono::steady_clock::now();
+    BatchOutcome outcome = runShotBatch(pool, table, dist, settings);
+    log.close();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%llu shots on %u threads in %.2fs (%.0f shots/s, %s, %s table)\n", outcome.shots, pool.size(),
+        seconds, outcome.shots / seconds, eventSolver ? "event solver" : "fixed step",
+        table.config.profile >= 0 ? TABLE_PROFILES[table.config.profile].name : "configured");
+
+    if (!eventSolver)
+    {
+        const SubstepStats& s = outcome.substeps;
+        printf("%.2f increments per moving step (most %d)\n", s.perMovingStep(), s.most);
+    }
+    if (logFile)
+        printf("%llu events logged to %s (%.0f events/s)\n", log.records(), logFile, log.records() / seconds);
+
+    for (int i = 0; i < outcome.balls; i++)
+        printf("Ball %d pocketed: %6.2f%%\n", i, 100.0 * outcome.pocketProbability(i));
+
+    // Resting place of the object ball, far end of the table at the top
+    printf("\nBall 1 resting positions (per mille of shots):\n");
+    for (int row = 0; row < BATCH_HIST_ROWS; row++)
+    {
+        for (int col = 0; col < BATCH_HIST_COLS; col++)
+            printf("%5.0f", 1000.0 * outcome.restCount(1, row, col) / outcome.shots);
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+//==============================================================================
+//                                PROGRAM:
+//                                Pool Events
+//==============================================================================
+//
+// Summarises an event log written by "Pool Table.exe --events file" or
+// "poolbatch --log file": how many ball hits, cushions and pockets, how many
+// runs they came from, and the hardest hit of each kind. --dump prints the
+// records themselves, one per line, optionally only those of one run.
+//
+// No GL or Windows libraries needed:
+//     g++ -std=c++14 -O2 -pthread -I.. poolevents.cpp -o poolevents
+//
+// Usage: poolevents file [--dump [count]] [--run id]
+//
+//==============================================================================
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "../eventlog.h"
+
+// Kinds of record counted, in the order they are printed
+const int EVENT_KINDS = 3;
+const unsigned KIND_TYPES[EVENT_KINDS] = { SIM_EVENT_BALL_HIT, SIM_EVENT_CUSHION, SIM_EVENT_POCKET };
+const char* KIND_NAMES[EVENT_KINDS] = { "ball", "cushion", "pocket" };
+
+// EVENT_KINDS if it is none of them
+static int kindOf(unsigned type)
+{
+    int kind = 0;
+    while (kind < EVENT_KINDS && KIND_TYPES[kind] != type)
+        kind++;
+    return kind;
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = 0;
+    bool dump = false;
+    unsigned long long dumpCount = ~0ull;
+    long long onlyRun = -1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--dump") == 0)
+        {
+            dump = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                dumpCount = strtoull(argv[++i], 0, 10);
+        }
+        else if (strcmp(argv[i], "--run") == 0 && i + 1 < argc)
+            onlyRun = atoll(argv[++i]);
+        else if (argv[i][0] != '-' && !path)
+            path = argv[i];
+        else
+            path = 0, argc = 0;
+    }
+    if (!path)
+    {
+        printf("Usage: %s file [--dump [count]] [--run id]\n", argv[0]);
+        return 1;
+    }
+
+    EventLogReader reader;
+    if (!reader.open(path))
+        return 1;
+
+    // The last slot counts anything unrecognised
+    unsigned long long counts[EVENT_KINDS + 1] = {};
+    float hardest[EVENT_KINDS + 1] = {};
+    unsigned long long records = 0, dumped = 0;
+    unsigned firstRun = ~0u, lastRun = 0;
+
+    std::vector<EventRecord> block(EVENT_LOG_BLOCK_RECORDS);
+    size_t n;
+    while ((n = reader.read(block.data(), block.size())) > 0)
+    {
+        for (size_t k = 0; k < n; k++)
+        {
+            const EventRecord& r = block[k];
+            if (onlyRun >= 0 && r.run != (unsigned long long)onlyRun)
+                continue;
+            records++;
+            firstRun = r.run < firstRun ? r.run : firstRun;
+            lastRun = r.run > lastRun ? r.run : lastRun;
+
+            const int kind = kindOf(r.type);
+            counts[kind]++;
+            hardest[kind] = r.speed > hardest[kind] ? r.speed : hardest[kind];
+
+            if (dump && dumped < dumpCount)
+            {
+                dumped++;
+                printf("run %u step %llu %-7s %2d", r.run, r.step, kind < EVENT_KINDS ? KIND_NAMES[kind] : "?", r.a);
+                if (r.b != EVENT_LOG_NO_BALL)
+                    printf(" %2d", r.b);
+                else
+                    printf("   ");
+                printf("  at %8.3f %8.3f  speed %8.3f\n", r.x, r.z, r.speed);
+            }
+        }
+    }
+
+    if (!records)
+    {
+        printf("No events\n");
+        return 0;
+    }
+    printf("%llu events from runs %u to %u\n", records, firstRun, lastRun);
+    for (int kind = 0; kind < EVENT_KINDS; kind++)
+        printf("  %-7s %12llu  hardest %8.3f units/s\n", KIND_NAMES[kind], counts[kind], hardest[kind]);
+    if (counts[EVENT_KINDS])
+        printf("  unknown %12llu\n", counts[EVENT_KINDS]);
+    return 0;
+}
@@ -0,0 +1,219 @@
+//==============================================================================
+//                                PROGRAM:
+//                                Pool Fit
+//==============================================================================
+//
+// Fits the cushion and ball damping constants of a table to measured ball
+// trajectories (see dampingfit.h for the CSV layout) and writes the table
+// back out with the fitted values, ready for --table.
+//
+// --demo writes reference shots played on the table with known constants,
+// plus a little measurement noise, so a fit can be checked against the
+// answer without a camera rig. With --noise 0 the fit should land on the
+// demo constants to about three decimal places:
+//     poolfit --demo demo.csv --noise 0 && poolfit demo.csv
+//
+// No GL or Windows libraries needed:
+//     g++ -std=c++14 -O2 -pthread -I.. poolfit.cpp -o poolfit
+//
+// Usage: poolfit reference.csv [threads] [--profile name] [--table file] [--event] [--out file]
+//                [--iterations n] [--restarts n]
+//        poolfit --demo reference.csv [--profile name] [--table file] [--event] [--shots n] [--noise units]
+//     0 threads uses every core. The fitted table goes to fitted.table unless
+//     --out says otherwise; a profile's fixed settings are written out in full.
+//
+//==============================================================================
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "../dampingfit.h"
+#include "../shotbatch.h"
+#include "../tablefile.h"
+
+// Constants the demo shots are played with
+const float DEMO_CONSTANTS[DAMP_PARAM_COUNT] = { 0.22f, 0.36f, 0.80f, 0.75f, 0.95f, 0.90f, 0.90f };
+
+// Sample rate and length of a demo shot, and the default noise on each
+// coordinate
+const int DEMO_SAMPLE_STEPS = 4;
+const double DEMO_SECONDS = 2.0;
+const double DEMO_NOISE = 0.02;
+
+// Top speed of the object ball's roll, units per second
+const double DEMO_ROLL = 20.0;
+
+// Cue ball in the near half and one object ball in the far half, each shot
+// aimed roughly at the object ball. The object ball is still rolling slowly:
+// the struck keep factors scale the struck ball's own velocity, so a ball at
+// rest would leave them unmeasured.
+static bool writeDemo(const char* path, const Simulation& table, int shots, double noise)
+{
+    FILE* out = fopen(path, "w");
+    if (!out)
+    {
+        printf("Cannot write %s\n", path);
+        return false;
+    }
+
+    Simulation sim;
+    sim.config = table.config;
+    sim.config.profile = -1;
+    sim.solver = table.solver;
+    for (int p = 0; p < DAMP_PARAM_COUNT; p++)
+    {
+        if (DampingFit::fitted(sim.config, p))
+            *dampingParam(sim.config, p) = DEMO_CONSTANTS[p];
+    }
+
+    const SimConfig& c = sim.config;
+    ShotRng rng(7);
+    fprintf(out, "shot,time,ball,x,z\n");
+    for (int s = 0; s < shots; s++)
+    {
+        sim.reset();
+        BallTable& b = sim.balls;
+        const float width = c.tableright - c.tableleft;
+        const float length = c.tablefront - c.tableback;
+        b.clear();
+        b.add((float)(c.tableleft + width * (0.3 + 0.4 * rng.uniform())), (float)(c.tableback + length * (0.6 + 0.3 * rng.uniform())));
+        const double roll = DEMO_ROLL * (0.5 + 0.5 * rng.uniform());
+        const double heading = 6.283185307179586 * rng.uniform();
+        b.add((float)(c.tableleft + width * (0.2 + 0.6 * rng.uniform())), (float)(c.tableback + length * (0.1 + 0.3 * rng.uniform())),
+            (float)(roll * std::cos(heading)), (float)(roll * std::sin(heading)), BALL_MOVING);
+
+        double dx = b.x[1] - b.x[CUE_BALL];
+        double dz = b.z[1] - b.z[CUE_BALL];
+        ShotParams shot;
+        shot.speed = (float)(120.0 + 60.0 * rng.uniform());
+        shot.angle = (float)(std::atan2(dx, -dz) + 0.05 * rng.normal());
+        shot.spin = 0.0f;
+        applyShot(sim, shot);
+
+        const int steps = (int)(DEMO_SECONDS / SIM_FIXED_DT);
+        for (int step = 0; step <= steps; step++)
+        {
+            if (step % DEMO_SAMPLE_STEPS == 0)
+            {
+                for (int i = 0; i < b.count; i++)
+                {
+                    // Full precision, so noise-free data replays exactly
+                    if (!b.pocketed(i))
+                        fprintf(out, "%d,%.9f,%d,%.9g,%.9g\n", s, step * SIM_FIXED_DT, i,
+                            (float)(b.x[i] + noise * rng.normal()), (float)(b.z[i] + noise * rng.normal()));
+                }
+            }
+            sim.step();
+        }
+    }
+    fclose(out);
+
+    printf("%d demo shots written to %s with noise %g and", shots, path, noise);
+    for (int p = 0; p < DAMP_PARAM_COUNT; p++)
+    {
+        if (DampingFit::fitted(c, p))
+            printf(" %s %.3f", DAMPING_PARAM_NAMES[p], DEMO_CONSTANTS[p]);
+    }
+    printf("\n");
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const char* reference = 0;
+    const char* outFile = "fitted.table";
+    const char* tableFile = 0;
+    const char* profile = 0;
+    unsigned threads = 0;
+    bool demo = false;
+    int demoShots = 200;
+    double demoNoise = DEMO_NOISE;
+    FitSettings settings;
+    Simulation table;
+
+    int positional = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--demo") == 0)
+            demo = true;
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+            profile = argv[++i];
+        else if (strcmp(argv[i], "--table") == 0 && i + 1 < argc)
+            tableFile = argv[++i];
+        else if (strcmp(argv[i], "--event") == 0)
+            table.solver = SIM_SOLVER_EVENT;
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            outFile = argv[++i];
+        else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+            settings.iterations = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--restarts") == 0 && i + 1 < argc)
+            settings.restarts = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--shots") == 0 && i + 1 < argc)
+            demoShots = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--noise") == 0 && i + 1 < argc)
+            demoNoise = atof(argv[++i]);
+        else if (argv[i][0] != '-' && positional == 0)
+        {
+            reference = argv[i];
+            positional++;
+        }
+        else if (argv[i][0] != '-' && positional == 1)
+        {
+            threads = (unsigned)atoi(argv[i]);
+            positional++;
+        }
+        else
+            reference = 0, positional = -1;
+    }
+    if (!reference)
+    {
+        printf("Usage: %s reference.csv [threads] [--profile name] [--table file] [--event] [--out file]\n", argv[0]);
+        printf("       [--iterations n] [--restarts n]\n");
+        printf("       %s --demo reference.csv [--profile name] [--table file] [--event] [--shots n] [--noise units]\n", argv[0]);
+        return 1;
+    }
+
+    if (profile && !useTableProfile(table.config, findTableProfile(profile)))
+    {
+        printf("Unknown table profile %s\n", profile);
+        return 1;
+    }
+    if (tableFile && !loadTableFile(tableFile, table.config))
+        return 1;
+    if (demo)
+        return writeDemo(reference, table, demoShots, demoNoise) ? 0 : 1;
+
+    std::vector<ReferenceShot> shots;
+    if (!loadReferenceShots(reference, shots))
+        return 1;
+    size_t samples = 0;
+    for (const ReferenceShot& s : shots)
+        samples += s.samples.size();
+
+    ThreadPool pool(threads);
+    DampingFit fit(pool, shots);
+    printf("Fitting %zu shots (%zu samples) on %u threads, %s\n", shots.size(), samples, pool.size(),
+        table.solver == SIM_SOLVER_EVENT ? "event solver" : "fixed step");
+
+    FitResult result = fit.fit(table, settings);
+    printf("RMS error %.4f -> %.4f units after %llu evaluations (%llu shot replays, %.0f replays/s, %.0f steps/s) in %.1fs\n",
+        result.startCost, result.cost, result.evaluations, result.shotRuns, result.shotRuns / result.seconds,
+        result.steps / result.seconds, result.seconds);
+
+    std::string comment = std::string("Damping constants fitted by poolfit to ") + reference + "\n";
+    for (int p = 0; p < DAMP_PARAM_COUNT; p++)
+    {
+        if (!DampingFit::fitted(result.config, p))
+            continue;
+        printf("  %-16s %.4f -> %.4f\n", DAMPING_PARAM_NAMES[p], *dampingParam(table.config, p),
+            *dampingParam(result.config, p));
+    }
+    char rms[64];
+    snprintf(rms, sizeof(rms), "RMS error %.4f units over %zu samples", result.cost, samples);
+    comment += rms;
+
+    if (!saveTableFile(outFile, result.config, comment))
+        return 1;
+    printf("Written to %s\n", outFile);
+    return 0;
+}
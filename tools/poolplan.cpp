@@ -0,0 +1,127 @@
+//==============================================================================
+//                                PROGRAM:
+//                                Pool Plan
+//==============================================================================
+//
+// Runs the shot planner on a table at rest and prints the best shots found.
+// The table is the game's starting layout with every ball stopped, or a full
+// rack of fifteen with --rack.
+//
+// No GL or Windows libraries needed:
+//     g++ -std=c++14 -O2 -pthread -I.. poolplan.cpp -o poolplan
+//
+// Usage: poolplan [threads] [--rack] [--event] [--profile name] [--table file]
+//                 [--target ball] [--top k] [--grid angles speeds spins] [--repeat n]
+//     --repeat plans the same table n times and reports the average time.
+//
+//==============================================================================
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "../shotplanner.h"
+#include "../tablefile.h"
+
+// Fifteen balls in a triangle on the far spot, cue ball in the near half
+static void rackBalls(Simulation& sim)
+{
+    BallTable& b = sim.balls;
+    const float d = sim.config.ballDiameter * 1.001f;
+    const float spot = sim.config.tableback * 0.5f;
+
+    b.clear();
+    b.add(0.0f, sim.config.tablefront * 0.5f);
+    for (int row = 0; row < 5; row++)
+    {
+        for (int k = 0; k <= row; k++)
+            b.add((k - 0.5f * row) * d, spot - row * d * 0.8660254f);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    unsigned threads = 0;
+    bool rack = false;
+    int repeat = 1;
+    PlannerSettings settings;
+    Simulation table;
+
+    int positional = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--rack") == 0)
+            rack = true;
+        else if (strcmp(argv[i], "--event") == 0)
+            table.solver = SIM_SOLVER_EVENT;
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+        {
+            if (!useTableProfile(table.config, findTableProfile(argv[++i])))
+            {
+                printf("Unknown table profile %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--table") == 0 && i + 1 < argc)
+        {
+            if (!loadTableFile(argv[++i], table.config))
+                return 1;
+        }
+        else if (strcmp(argv[i], "--target") == 0 && i + 1 < argc)
+            settings.target = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc)
+            settings.top = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+            repeat = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--grid") == 0 && i + 3 < argc)
+        {
+            settings.angles = atoi(argv[++i]);
+            settings.speeds = atoi(argv[++i]);
+            settings.spins = atoi(argv[++i]);
+        }
+        else if (argv[i][0] != '-' && positional == 0)
+        {
+            threads = (unsigned)atoi(argv[i]);
+            positional++;
+        }
+        else
+        {
+            printf("Usage: %s [threads] [--rack] [--event] [--profile name] [--table file]\n", argv[0]);
+            printf("       [--target ball] [--top k] [--grid angles speeds spins] [--repeat n]\n");
+            return 1;
+        }
+    }
+
+    // Plan from a table at rest
+    if (rack)
+        rackBalls(table);
+    for (int i = 0; i < table.balls.count; i++)
+    {
+        table.balls.vx[i] = table.balls.vz[i] = 0.0f;
+        table.balls.flags[i] &= (unsigned char)~BALL_MOVING;
+    }
+    table.cueHit = true;
+
+    ThreadPool pool(threads);
+    ShotPlanner planner(pool);
+    PlannerResult result;
+    double seconds = 0.0;
+    for (int r = 0; r < (repeat > 0 ? repeat : 1); r++)
+    {
+        result = planner.plan(table, settings);
+        seconds += result.seconds;
+    }
+
+    printf("%llu candidates on %u threads in %.1f ms (%llu scratches, %llu misses, %llu steps)\n",
+        result.candidates, pool.size(), 1000.0 * seconds / (repeat > 0 ? repeat : 1),
+        result.scratches, result.misses, result.steps);
+
+    if (result.count == 0)
+        printf("No candidate made a legal shot; try a finer --grid or another --target\n");
+    for (int k = 0; k < result.count; k++)
+    {
+        const PlannedShot& s = result.shots[k];
+        printf("%2d. angle %7.2f deg  speed %6.1f  spin %5.2f  score %8.2f  potted %llx\n", k + 1,
+            s.shot.angle * 180.0 / 3.14159265358979, s.shot.speed, s.shot.spin, s.score, s.pocketed);
+    }
+    return 0;
+}
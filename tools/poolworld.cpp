@@ -0,0 +1,260 @@
+//==============================================================================
+//                                PROGRAM:
+//                                Pool World
+//==============================================================================
+//
+// Hosts many tables at once and steps them across every core. Work comes in
+// as one command per line on stdin and every command gets one line back on
+// stdout, so a backend can drive it over a pipe:
+//
+//     add [profile name] [table file] [event]   -> ok <id>
+//     shot <id> <speed> <angle degrees>          strike the cue ball
+//     cue <id> <dz>                              slide the cue, as the player does
+//     reset <id>
+//     remove <id>
+//     step <steps>                               step every table, up to MAX_STEP_COUNT
+//     state <id>                                 -> state <id> <step> <idle> <hash> <pocketed mask>
+//     balls <id>                                 -> balls <id> <x> <z> <flags> ...
+//     stats                                      totals since start
+//     quit
+//
+// Anything that fails answers "error <reason>". The hash is the one session
+// recordings store (see replay.h), so a table can be checked against a game
+// recorded elsewhere.
+//
+// --bench fills the world with jittered opening shots and reports how many
+// table-steps per second it gets through.
+//
+// No GL or Windows libraries needed:
+//     g++ -std=c++14 -O2 -pthread -I.. poolworld.cpp -o poolworld
+//
+// Usage: poolworld [threads]
+//        poolworld --bench tables seconds [threads] [--event] [--profile name]
+//
+//==============================================================================
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "../tableworld.h"
+#include "../shotbatch.h"
+#include "../tablefile.h"
+#include "../replay.h"
+
+const double DEG_TO_RAD = 3.14159265358979 / 180.0;
+
+// Most steps one step command may ask for: ten minutes of table time
+const long long MAX_STEP_COUNT = (long long)(600.0 / SIM_FIXED_DT);
+
+static void printStats(const char* label, const WorldStats& s)
+{
+    printf("%s %llu tables %llu table-steps (%llu computed) in %.3fs, %.0f table-steps/s\n", label,
+        s.tables, s.tableSteps, s.computedSteps, s.seconds, s.tableStepsPerSecond());
+}
+
+// Reads "add" options into a fresh table. Returns false with reason set.
+static bool buildTable(std::istringstream& in, Simulation& table, std::string& reason)
+{
+    std::string word;
+    while (in >> word)
+    {
+        if (word == "event")
+            table.solver = SIM_SOLVER_EVENT;
+        else if (word == "profile" && (in >> word))
+        {
+            if (!useTableProfile(table.config, findTableProfile(word.c_str())))
+            {
+                reason = "unknown profile " + word;
+                return false;
+            }
+        }
+        else if (word == "table" && (in >> word))
+        {
+            // Quietly, so the reply stays one line
+            std::string why;
+            if (!loadTableFile(word.c_str(), table.config, &why))
+            {
+                reason = "bad table file: " + why;
+                return false;
+            }
+        }
+        else
+        {
+            reason = "bad add option " + word;
+            return false;
+        }
+    }
+    return true;
+}
+
+static int serve(ThreadPool& pool)
+{
+    TableWorld world;
+    WorldStats total;
+    std::string line;
+
+    while (std::getline(std::cin, line))
+    {
+        std::istringstream in(line);
+        std::string command;
+        if (!(in >> command) || command[0] == '#')
+            continue;
+        if (command == "quit")
+            break;
+
+        if (command == "add")
+        {
+            Simulation table;
+            std::string reason;
+            if (buildTable(in, table, reason))
+                printf("ok %u\n", world.add(table));
+            else
+                printf("error %s\n", reason.c_str());
+        }
+        else if (command == "step")
+        {
+            // Signed, so "-1" is refused rather than wrapping round
+            long long steps = 0;
+            if ((in >> steps) && steps > 0 && steps <= MAX_STEP_COUNT)
+            {
+                WorldStats s = stepWorld(pool, world, (unsigned)steps);
+                total.add(s);
+                printStats("stepped", s);
+            }
+            else
+                printf("error step needs a count\n");
+        }
+        else if (command == "stats")
+            printStats("total", total);
+        else if (command != "shot" && command != "cue" && command != "reset" && command != "remove"
+            && command != "state" && command != "balls")
+            printf("error bad command %s\n", command.c_str());
+        else
+        {
+            // Everything else names a table
+            unsigned id = 0;
+            Simulation* sim = (in >> id) ? world.table(id) : nullptr;
+            if (!sim)
+            {
+                printf("error no such table\n");
+                fflush(stdout);
+                continue;
+            }
+
+            float a = 0.0f, b = 0.0f;
+            if (command == "shot" && (in >> a >> b))
+            {
+                ShotParams shot = { a, (float)(b * DEG_TO_RAD), 0.0f };
+                applyShot(*sim, shot);
+                printf("ok\n");
+            }
+            else if (command == "cue" && (in >> a))
+            {
+                sim->moveCue(a);
+                printf("ok\n");
+            }
+            else if (command == "reset")
+            {
+                sim->reset();
+                printf("ok\n");
+            }
+            else if (command == "remove")
+            {
+                world.remove(id);
+                printf("ok\n");
+            }
+            else if (command == "state")
+            {
+                BallMask pocketed = 0;
+                for (int i = 0; i < sim->balls.count; i++)
+                {
+                    if (sim->balls.pocketed(i))
+                        pocketed |= (BallMask)1 << i;
+                }
+                printf("state %u %llu %d %08x %x\n", id, sim->stepCount, sim->idle() ? 1 : 0,
+                    stateHash(*sim), (unsigned)pocketed);
+            }
+            else if (command == "balls")
+            {
+                printf("balls %u", id);
+                for (int i = 0; i < sim->balls.count; i++)
+                    printf(" %.3f %.3f %d", sim->balls.x[i], sim->balls.z[i], sim->balls.flags[i]);
+                printf("\n");
+            }
+            else
+                printf("error bad arguments for %s\n", command.c_str());
+        }
+        fflush(stdout);
+    }
+    return 0;
+}
+
+// Fill the world with opening shots and step it in one second batches
+static int bench(ThreadPool& pool, unsigned tables, double seconds, const Simulation& table)
+{
+    TableWorld world;
+    ShotRng rng(1);
+    for (unsigned i = 0; i < tables; i++)
+    {
+        Simulation& sim = *world.table(world.add(table));
+        ShotParams shot;
+        shot.speed = (float)(134.16 + 10.0 * rng.normal());
+        shot.angle = (float)(-0.4636 + 0.02 * rng.normal());
+        shot.spin = 0.0f;
+        applyShot(sim, shot);
+    }
+
+    printf("%u tables on %u threads, %s\n", tables, pool.size(),
+        table.solver == SIM_SOLVER_EVENT ? "event solver" : "fixed step");
+
+    WorldStats total;
+    const unsigned batch = (unsigned)(1.0 / SIM_FIXED_DT);
+    for (double t = 0.0; t < seconds; t += 1.0)
+    {
+        total.add(stepWorld(pool, world, batch));
+    }
+    printStats("total", total);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned threads = 0;
+    bool benchmark = false;
+    unsigned tables = 10000;
+    double seconds = 10.0;
+    Simulation table;
+
+    int positional = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--bench") == 0 && i + 2 < argc)
+        {
+            benchmark = true;
+            tables = (unsigned)atoi(argv[++i]);
+            seconds = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--event") == 0)
+            table.solver = SIM_SOLVER_EVENT;
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc
+            && useTableProfile(table.config, findTableProfile(argv[i + 1])))
+            i++;
+        else if (argv[i][0] != '-' && positional == 0)
+        {
+            threads = (unsigned)atoi(argv[i]);
+            positional++;
+        }
+        else
+        {
+            printf("Usage: %s [threads]\n", argv[0]);
+            printf("       %s --bench tables seconds [threads] [--event] [--profile name]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    ThreadPool pool(threads);
+    return benchmark ? bench(pool, tables, seconds, table) : serve(pool);
+}
@@ -0,0 +1,50 @@
+#pragma once
+//==============================================================================
+//                                Triple Buffer
+//==============================================================================
+//
+// Hands the latest value of something from one writer thread to one reader
+// thread without either ever waiting on the other. There are three slots:
+// the writer fills its back slot and swaps it into the middle, the reader
+// swaps the middle out into its front slot when something new is there.
+// Values the reader never got to are simply overwritten.
+//
+// The middle index and a "fresh" bit share one atomic, so every handover is
+// a single exchange.
+//
+//==============================================================================
+#include <atomic>
+
+template <typename T>
+class TripleBuffer
+{
+public:
+    // Writer: the slot to fill, then publish() it
+    T& back() { return this->slots[this->backIndex]; }
+
+    void publish()
+    {
+        this->backIndex = this->middle.exchange(this->backIndex | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Reader: swap in the newest published value, if there is one. Returns
+    // true if front() changed.
+    bool update()
+    {
+        if (!(this->middle.load(std::memory_order_relaxed) & FRESH))
+            return false;
+        this->frontIndex = this->middle.exchange(this->frontIndex, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    const T& front() const { return this->slots[this->frontIndex]; }
+
+private:
+    static const unsigned INDEX = 3;
+    static const unsigned FRESH = 4;
+
+    T slots[3];
+    unsigned backIndex = 0;                 // Writer only
+    std::atomic<unsigned> middle{ 1 };
+    unsigned frontIndex = 2;                // Reader only
+};